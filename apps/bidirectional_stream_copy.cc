@@ -16,8 +16,8 @@ void bidirectional_stream_copy(Socket &socket) {
     EventLoop _eventloop{};
     FileDescriptor _input{STDIN_FILENO};
     FileDescriptor _output{STDOUT_FILENO};
-    ByteStream _outbound{buffer_size};
-    ByteStream _inbound{buffer_size};
+    ByteStream _outbound{buffer_size, ByteStream::Backend::Ring};
+    ByteStream _inbound{buffer_size, ByteStream::Backend::Ring};
     bool _outbound_shutdown{false};
     bool _inbound_shutdown{false};
 
@@ -45,7 +45,7 @@ void bidirectional_stream_copy(Socket &socket) {
                         [&] {
                             // cerr<<"read from outbound byte stream into socket"<<endl;
                             const size_t bytes_to_write = min(max_copy_length, _outbound.buffer_size());
-                            const size_t bytes_written = socket.write(_outbound.peek_output(bytes_to_write), false);
+                            const size_t bytes_written = socket.write(_outbound.peek_views(bytes_to_write), false);
                             _outbound.pop_output(bytes_written);
                             if (_outbound.eof()) {
                                 socket.shutdown(SHUT_WR);
@@ -75,7 +75,7 @@ void bidirectional_stream_copy(Socket &socket) {
                         [&] {
                             // cerr<<"read from inbound byte stream into stdout"<<endl;
                             const size_t bytes_to_write = min(max_copy_length, _inbound.buffer_size());
-                            const size_t bytes_written = _output.write(_inbound.peek_output(bytes_to_write), false);
+                            const size_t bytes_written = _output.write(_inbound.peek_views(bytes_to_write), false);
                             _inbound.pop_output(bytes_written);
 
                             if (_inbound.eof()) {
@@ -93,3 +93,90 @@ void bidirectional_stream_copy(Socket &socket) {
         }
     }
 }
+
+void bidirectional_stream_copy(RingStream &stream) {
+    constexpr size_t max_copy_length = 65536;
+    constexpr size_t buffer_size = 1048576;
+
+    EventLoop _eventloop{};
+    FileDescriptor _input{STDIN_FILENO};
+    FileDescriptor _output{STDOUT_FILENO};
+    ByteStream _outbound{buffer_size, ByteStream::Backend::Ring};
+    ByteStream _inbound{buffer_size, ByteStream::Backend::Ring};
+    bool _outbound_shutdown{false};
+    bool _inbound_shutdown{false};
+
+    stream.set_blocking(false);
+    _input.set_blocking(false);
+    _output.set_blocking(false);
+
+    // rule 1: read from stdin into outbound byte stream
+    _eventloop.add_rule(
+        _input,
+        Direction::In,
+        [&] {
+            _outbound.write(_input.read(_outbound.remaining_capacity()));
+            if (_input.eof()) {
+                _outbound.end_input();
+            }
+        },
+        [&] { return (not _outbound.error()) and (_outbound.remaining_capacity() > 0) and (not _inbound.error()); },
+        [&] { _outbound.end_input(); });
+
+    // rules 2 and 3: the other end of the stream has made progress; the copying is done by pump() below
+    _eventloop.add_rule(
+        stream.event_fd(),
+        Direction::In,
+        [&] { stream.clear_event(); },
+        [&] { return not _outbound_shutdown or not _inbound.input_ended(); });
+
+    // rule 4: read from inbound byte stream into stdout
+    _eventloop.add_rule(_output,
+                        Direction::Out,
+                        [&] {
+                            const size_t bytes_to_write = min(max_copy_length, _inbound.buffer_size());
+                            const size_t bytes_written = _output.write(_inbound.peek_views(bytes_to_write), false);
+                            _inbound.pop_output(bytes_written);
+
+                            if (_inbound.eof()) {
+                                _output.close();
+                                _inbound_shutdown = true;
+                            }
+                        },
+                        [&] { return (not _inbound.buffer_empty()) or (_inbound.eof() and not _inbound_shutdown); },
+                        [&] { _inbound.end_input(); });
+
+    //  每次醒来都把两个方向能搬的搬完: 读/写到0字节为止, 否则stream的另一端不一定会再唤醒我们
+    const auto pump = [&] {
+        while (not _outbound.buffer_empty()) {
+            const size_t bytes_to_write = min(max_copy_length, _outbound.buffer_size());
+            const size_t bytes_written = stream.write(_outbound.peek_views(bytes_to_write), false);
+            if (bytes_written == 0) {
+                break;
+            }
+            _outbound.pop_output(bytes_written);
+        }
+        if (_outbound.eof() and not _outbound_shutdown) {
+            stream.shutdown(SHUT_WR);
+            _outbound_shutdown = true;
+        }
+        while (not _inbound.input_ended() and _inbound.remaining_capacity() > 0) {
+            string data = stream.read(_inbound.remaining_capacity());
+            if (data.empty()) {
+                if (stream.eof()) {
+                    _inbound.end_input();
+                }
+                break;
+            }
+            _inbound.write(move(data));
+        }
+    };
+
+    // loop until completion
+    while (true) {
+        pump();
+        if (EventLoop::Result::Exit == _eventloop.wait_next_event(-1)) {
+            return;
+        }
+    }
+}
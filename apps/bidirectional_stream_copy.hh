@@ -1,9 +1,13 @@
 #ifndef SPONGE_APPS_BIDIRECTIONAL_STREAM_COPY_HH
 #define SPONGE_APPS_BIDIRECTIONAL_STREAM_COPY_HH
 
+#include "ring_stream.hh"
 #include "socket.hh"
 
 //! Copy socket input/output to stdin/stdout until finished
 void bidirectional_stream_copy(Socket &socket);
 
+//! Copy the input/output of an in-process stream (e.g. an InProcessTCPSpongeSocket) to stdin/stdout
+void bidirectional_stream_copy(RingStream &stream);
+
 #endif  // SPONGE_APPS_BIDIRECTIONAL_STREAM_COPY_HH
@@ -8,7 +8,7 @@
 using namespace std;
 
 void program_body() {
-    EventLoop loop;
+    EventLoop loop{EventLoop::Backend::Epoll};  //  ~63000个socket: 不必每次都重建pollfd列表
     vector<UDPSocket> sockets;
     vector<optional<Address>> peers;
     sockets.reserve(66000);
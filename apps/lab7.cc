@@ -110,10 +110,25 @@ class NetworkInterfaceAdapter : public TCPOverIPv4Adapter {
         _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
         send_pending();
     }
+    vector<TCPSegment> read_batch() {
+        vector<TCPSegment> segs;
+        if (auto seg = read()) {
+            segs.push_back(move(seg.value()));
+        }
+        return segs;
+    }
+    void write_batch(queue<TCPSegment> &segs) {
+        while (not segs.empty()) {
+            _interface.send_datagram(wrap_tcp_in_ip(segs.front()), _next_hop);
+            segs.pop();
+        }
+        send_pending();
+    }
     void tick(const size_t ms_since_last_tick) {
         _interface.tick(ms_since_last_tick);
         send_pending();
     }
+    optional<size_t> next_timeout() const { return _interface.next_timeout(); }
     NetworkInterface &interface() { return _interface; }
     queue<EthernetFrame> frames_out() { return _interface.frames_out(); }
 
@@ -121,12 +136,12 @@ class NetworkInterfaceAdapter : public TCPOverIPv4Adapter {
     FileDescriptor &frame_fd() { return _data_socket_pair.second; }
 };
 
-class TCPSocketLab7 : public TCPSpongeSocket<NetworkInterfaceAdapter> {
+class TCPSocketLab7 : public InProcessTCPSpongeSocket<NetworkInterfaceAdapter> {
     Address _local_address;
 
   public:
     TCPSocketLab7(const Address &ip_address, const Address &next_hop)
-        : TCPSpongeSocket<NetworkInterfaceAdapter>(NetworkInterfaceAdapter(ip_address, next_hop))
+        : InProcessTCPSpongeSocket<NetworkInterfaceAdapter>(NetworkInterfaceAdapter(ip_address, next_hop))
         , _local_address(ip_address) {}
 
     void connect(const Address &address) {
@@ -137,7 +152,7 @@ class TCPSocketLab7 : public TCPSpongeSocket<NetworkInterfaceAdapter> {
         multiplexer_config.source = _local_address;
         multiplexer_config.destination = address;
 
-        TCPSpongeSocket<NetworkInterfaceAdapter>::connect({}, multiplexer_config);
+        InProcessTCPSpongeSocket<NetworkInterfaceAdapter>::connect({}, multiplexer_config);
     }
 
     void bind(const Address &address) {
@@ -150,7 +165,7 @@ class TCPSocketLab7 : public TCPSpongeSocket<NetworkInterfaceAdapter> {
     void listen_and_accept() {
         FdAdapterConfig multiplexer_config;
         multiplexer_config.source = _local_address;
-        TCPSpongeSocket<NetworkInterfaceAdapter>::listen_and_accept({}, multiplexer_config);
+        InProcessTCPSpongeSocket<NetworkInterfaceAdapter>::listen_and_accept({}, multiplexer_config);
     }
 
     NetworkInterfaceAdapter &adapter() { return _datagram_adapter; }
@@ -0,0 +1,120 @@
+#include "bitmap_stream_reassembler.hh"
+#include "stream_reassembler.hh"
+#include "tcp_config.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t len = 64 * 1024 * 1024;
+constexpr size_t capacity = TCPConfig::DEFAULT_CAPACITY;
+constexpr size_t max_seg_len = TCPConfig::MAX_PAYLOAD_SIZE;
+constexpr size_t max_overlap = 512;
+
+//! How the segments of each window are ordered before they reach the reassembler
+enum class Traffic {
+    Random,    //!< shuffled, overlapping segments (like fsm_stream_reassembler_win)
+    Reverse,   //!< every window delivered back to front
+    Duplicate  //!< shuffled, and each segment delivered four times
+};
+
+//! (index, length) of every segment, one window (of at most `capacity` bytes) after another
+vector<tuple<size_t, size_t>> make_segments(const Traffic traffic, mt19937 &rd) {
+    vector<tuple<size_t, size_t>> segments;
+    size_t window_start = 0;
+    while (window_start < len) {
+        const size_t window_end = min(len, window_start + capacity);
+        vector<tuple<size_t, size_t>> window;
+        for (size_t offset = window_start; offset < window_end;) {
+            const size_t size = min(window_end - offset, 1 + rd() % max_seg_len);
+            const size_t offs = min(offset - window_start, static_cast<size_t>(rd() % max_overlap));
+            window.emplace_back(offset - offs, size + offs);
+            offset += size;
+        }
+        switch (traffic) {
+            case Traffic::Random:
+                shuffle(window.begin(), window.end(), rd);
+                break;
+            case Traffic::Reverse:
+                reverse(window.begin(), window.end());
+                break;
+            case Traffic::Duplicate: {
+                const auto once = window;
+                for (unsigned i = 0; i < 3; ++i) {
+                    window.insert(window.end(), once.begin(), once.end());
+                }
+                shuffle(window.begin(), window.end(), rd);
+                break;
+            }
+        }
+        segments.insert(segments.end(), window.begin(), window.end());
+        window_start = window_end;
+    }
+    return segments;
+}
+
+//! Push every segment (as a slice of `data`, the way TCPReceiver hands over payloads),
+//! draining the output after each window, and report the throughput
+template <typename Reassembler>
+void reassemble(const char *label, const Buffer &data, const vector<tuple<size_t, size_t>> &segments) {
+    Reassembler reassembler{capacity};
+    size_t bytes_received = 0;
+
+    const auto first_time = high_resolution_clock::now();
+
+    for (const auto &[index, size] : segments) {
+        Buffer payload{data};
+        payload.remove_prefix(index);
+        payload.remove_suffix(payload.size() - size);
+        reassembler.push_substring(payload, index, index + size == len);
+
+        if (reassembler.stream_out().remaining_capacity() == 0 or reassembler.stream_out().input_ended()) {
+            bytes_received += reassembler.stream_out().read_buffers(reassembler.stream_out().buffer_size()).size();
+        }
+    }
+
+    const auto final_time = high_resolution_clock::now();
+
+    if (bytes_received != len or not reassembler.stream_out().eof()) {
+        throw runtime_error(string(label) + ": reassembled " + to_string(bytes_received) + " of " +
+                            to_string(len) + " bytes");
+    }
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    const auto gigabits_per_second = len * 8.0 / double(duration);
+
+    cout << fixed << setprecision(2);
+    cout << label << gigabits_per_second << " Gbit/s (" << segments.size() << " segments)\n";
+}
+
+int main() {
+    try {
+        mt19937 rd{0x5eed};
+        string source(len, 0);
+        generate(source.begin(), source.end(), [&] { return rd(); });
+        const Buffer data{move(source)};
+
+        for (const auto traffic : {Traffic::Random, Traffic::Reverse, Traffic::Duplicate}) {
+            const auto segments = make_segments(traffic, rd);
+            const char *name = traffic == Traffic::Random    ? "random   "
+                               : traffic == Traffic::Reverse ? "reverse  "
+                                                             : "duplicate";
+            reassemble<StreamReassembler>((string(name) + ", map of runs: ").c_str(), data, segments);
+            reassemble<BitmapStreamReassembler>((string(name) + ", bitmap+ring: ").c_str(), data, segments);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
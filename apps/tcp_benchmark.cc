@@ -28,8 +28,12 @@ void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segme
     segments.clear();
 }
 
-void main_loop(const bool reorder) {
+void main_loop(const bool reorder,
+               const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
+               const uint16_t mss = TCPConfig::MAX_PAYLOAD_SIZE) {
     TCPConfig config;
+    config.send_capacity = config.recv_capacity = capacity;
+    config.mss = mss;
     TCPConnection x{config}, y{config};
 
     string string_to_send(len, 'x');
@@ -52,7 +56,9 @@ void main_loop(const bool reorder) {
         // write input into x
         while (bytes_to_send.size() and x.remaining_outbound_capacity()) {
             const auto want = min(x.remaining_outbound_capacity(), bytes_to_send.size());
-            const auto written = x.write(string(bytes_to_send.str().substr(0, want)));
+            Buffer chunk{bytes_to_send};
+            chunk.remove_suffix(chunk.size() - want);
+            const auto written = x.write(chunk);
             if (want != written) {
                 throw runtime_error("want = " + to_string(want) + ", written = " + to_string(written));
             }
@@ -96,17 +102,156 @@ void main_loop(const bool reorder) {
 
     cout << fixed << setprecision(2);
     cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ") << gigabits_per_second
-         << " Gbit/s\n";
+         << " Gbit/s";
+    if (capacity != TCPConfig::DEFAULT_CAPACITY) {
+        cout << " (" << capacity / 1024 << " KiB buffers)";
+    }
+    if (mss != TCPConfig::MAX_PAYLOAD_SIZE) {
+        cout << " (MSS " << mss << ")";
+    }
+    cout << "\n";
 
     while (x.active() or y.active()) {
         loop();
     }
 }
 
-int main() {
+//! An application making many small writes: `writes_per_rtt` writes of `write_size` bytes go into x
+//! between each exchange of segments, so that Nagle's algorithm has unacknowledged data to wait on.
+void small_write_loop(const bool nagle, const size_t write_size = 64, const size_t writes_per_rtt = 32) {
+    constexpr size_t small_len = 16 * 1024 * 1024;
+    TCPConfig config;
+    config.nagle = nagle;
+    TCPConnection x{config}, y{config};
+
+    const string chunk(write_size, 'x');
+    size_t bytes_written = 0, bytes_received = 0, segments_sent = 0;
+    x.connect();
+    y.end_input_stream();
+
+    const auto first_time = high_resolution_clock::now();
+
+    vector<TCPSegment> segments;
+    while (bytes_received < small_len) {
+        for (size_t i = 0; i < writes_per_rtt and bytes_written < small_len; ++i) {
+            if (x.remaining_outbound_capacity() < chunk.size()) {
+                break;
+            }
+            bytes_written += x.write(chunk);
+        }
+
+        segments_sent += x.segments_out().size();
+        move_segments(x, y, segments, false);
+        move_segments(y, x, segments, false);
+
+        bytes_received += y.inbound_stream().read_buffers(y.inbound_stream().buffer_size()).size();
+    }
+
+    const auto final_time = high_resolution_clock::now();
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+
+    const auto gigabits_per_second = small_len * 8.0 / double(duration);
+
+    cout << fixed << setprecision(2);
+    cout << "Throughput of " << write_size << "-byte writes" << (nagle ? ", Nagle:   " : ", nodelay: ")
+         << gigabits_per_second << " Gbit/s (" << segments_sent << " segments)\n";
+
+    x.end_input_stream();
+    while (x.active() or y.active()) {
+        move_segments(x, y, segments, false);
+        move_segments(y, x, segments, false);
+        x.tick(1000);
+        y.tick(1000);
+    }
+}
+
+//! How write_loop() hands each chunk to ByteStream::write
+enum class WriteMode {
+    Copy,  //!< write(const string &): the caller's string, then the stream's own copy (2 copies/byte)
+    Move,  //!< write(string &&): only the caller's string (1 copy/byte)
+    Slice  //!< write(Buffer): a slice of the source, shared with the stream (0 copies/byte)
+};
+
+//! Push `len` bytes through a ByteStream and drain them with read_buffers(), so that the
+//! only per-byte copies left are the ones made on the way in.
+void write_loop(const WriteMode mode) {
+    ByteStream stream{TCPConfig::DEFAULT_CAPACITY};
+    Buffer bytes_to_send{string(len, 'x')};
+    size_t bytes_received = 0;
+
+    const auto first_time = high_resolution_clock::now();
+
+    while (bytes_to_send.size()) {
+        const auto want = min(stream.remaining_capacity(), bytes_to_send.size());
+        Buffer chunk{bytes_to_send};
+        chunk.remove_suffix(chunk.size() - want);
+
+        size_t written = 0;
+        switch (mode) {
+            case WriteMode::Copy: {
+                const string data{chunk.str()};
+                written = stream.write(data);
+                break;
+            }
+            case WriteMode::Move:
+                written = stream.write(chunk.copy());
+                break;
+            case WriteMode::Slice:
+                written = stream.write(chunk);
+                break;
+        }
+        if (want != written) {
+            throw runtime_error("want = " + to_string(want) + ", written = " + to_string(written));
+        }
+        bytes_to_send.remove_prefix(written);
+
+        bytes_received += stream.read_buffers(stream.buffer_size()).size();
+    }
+
+    if (bytes_received != len) {
+        throw runtime_error("bytes written vs. read don't match");
+    }
+
+    const auto final_time = high_resolution_clock::now();
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+
+    const auto gigabits_per_second = len * 8.0 / double(duration);
+
+    const char *label = mode == WriteMode::Copy   ? "ByteStream write(const string &), 2 copies/byte: "
+                        : mode == WriteMode::Move ? "ByteStream write(string &&),      1 copy/byte:   "
+                                                  : "ByteStream write(Buffer),         0 copies/byte: ";
+    cout << fixed << setprecision(2);
+    cout << label << gigabits_per_second << " Gbit/s\n";
+}
+
+//! Throughput for MSSes from the IPv4 minimum up to a 9000-byte-MTU jumbo frame
+void mss_sweep() {
+    for (const uint16_t mss : {536, 1000, 1460, 4096, 8960}) {
+        main_loop(false, TCPConfig::DEFAULT_CAPACITY, mss);
+    }
+}
+
+int main(int argc, char **argv) {
     try {
+        if (argc == 2 && string(argv[1]) == "mss") {
+            mss_sweep();
+            return EXIT_SUCCESS;
+        }
+        if (argc != 1) {
+            cerr << "Usage: " << argv[0] << " [mss]\n";
+            return EXIT_FAILURE;
+        }
+
+        write_loop(WriteMode::Copy);
+        write_loop(WriteMode::Move);
+        write_loop(WriteMode::Slice);
         main_loop(false);
         main_loop(true);
+        main_loop(false, 1024 * 1024);
+        small_write_loop(false);
+        small_write_loop(true);
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
@@ -30,7 +30,19 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
          << "\n\n"
 
-         << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
+         << "   -M <mss>        Set the maximum segment size to <mss>           " << TCPConfig::MAX_PAYLOAD_SIZE
+         << "\n\n"
+
+         << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n"
+         << "   -A              Adapt rt_timeout to the measured RTT            (fixed)\n"
+         << "   -C <algo>       Congestion control: none, reno or cubic         (none)\n"
+         << "   -F              Fast retransmit on triple duplicate ACKs        (off)\n"
+         << "   -S              Negotiate SACK (implies -F)                     (off)\n"
+         << "   -W              Negotiate window scaling                        (off)\n"
+         << "   -D              Delay ACKs (every second segment or 40 ms)      (off)\n"
+         << "   -N              Use Nagle's algorithm for small writes          (off)\n\n"
+
+         << "   -E <backend>    Event loop backend: poll, epoll or io_uring     (poll)\n\n"
 
          << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
 
@@ -83,11 +95,64 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
             c_fsm.recv_capacity = strtol(argv[curr + 1], nullptr, 0);
             curr += 2;
 
+        } else if (strncmp("-M", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -M requires one argument.");
+            c_fsm.mss = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
         } else if (strncmp("-t", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -t requires one argument.");
             c_fsm.rt_timeout = strtol(argv[curr + 1], nullptr, 0);
             curr += 2;
 
+        } else if (strncmp("-A", argv[curr], 3) == 0) {
+            c_fsm.rtt_estimation = true;
+            curr += 1;
+
+        } else if (strncmp("-F", argv[curr], 3) == 0) {
+            c_fsm.fast_retransmit = true;
+            curr += 1;
+
+        } else if (strncmp("-S", argv[curr], 3) == 0) {
+            c_fsm.sack = true;
+            curr += 1;
+
+        } else if (strncmp("-W", argv[curr], 3) == 0) {
+            c_fsm.window_scaling = true;
+            curr += 1;
+
+        } else if (strncmp("-D", argv[curr], 3) == 0) {
+            c_fsm.delayed_ack = true;
+            curr += 1;
+
+        } else if (strncmp("-N", argv[curr], 3) == 0) {
+            c_fsm.nagle = true;
+            curr += 1;
+
+        } else if (strncmp("-E", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -E requires one argument.");
+            if (strcmp("epoll", argv[curr + 1]) == 0) {
+                c_filt.event_loop = EventLoop::Backend::Epoll;
+            } else if (strcmp("io_uring", argv[curr + 1]) == 0) {
+                c_filt.event_loop = EventLoop::Backend::IoUring;
+            } else if (strcmp("poll", argv[curr + 1]) != 0) {
+                show_usage(argv[0], "ERROR: -E must be poll, epoll or io_uring.");
+                exit(1);
+            }
+            curr += 2;
+
+        } else if (strncmp("-C", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -C requires one argument.");
+            if (strcmp("reno", argv[curr + 1]) == 0) {
+                c_fsm.congestion_control = CongestionControlAlgorithm::Reno;
+            } else if (strcmp("cubic", argv[curr + 1]) == 0) {
+                c_fsm.congestion_control = CongestionControlAlgorithm::Cubic;
+            } else if (strcmp("none", argv[curr + 1]) != 0) {
+                show_usage(argv[0], "ERROR: -C must be none, reno or cubic.");
+                exit(1);
+            }
+            curr += 2;
+
         } else if (strncmp("-d", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -t requires one argument.");
             tundev = argv[curr + 1];
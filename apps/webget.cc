@@ -26,7 +26,7 @@ void get_URL(const string &host, const string &path) {
     // CS144TCPSocket tcp_socket;
     FullStackSocket tcp_socket;
     tcp_socket.connect(addr);   
-    //  send req
+    //  send req (FullStackSocket的数据走in-process stream, 不经过socketpair)
     string request("GET " + path + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" + "Connection: close\r\n" + "\r\n");
     tcp_socket.write(request);
     while(!tcp_socket.eof())
@@ -0,0 +1,26 @@
+#include "eventloop.hh"
+
+#include "address.hh"
+#include "socket.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main() {
+    try {
+        {
+#include "eventloop_example_1.cc"
+        } {
+#include "eventloop_example_2.cc"
+        }
+    } catch (...) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+const uint16_t portnum = ((std::random_device()()) % 50000) + 1025;
+
+// the same rules behave the same way with every backend
+for (const auto backend : {EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring}) {
+    // a backend that this kernel or this build can't provide (e.g. io_uring before Linux 5.17) is skipped
+    EventLoop loop;
+    try {
+        loop = EventLoop{backend};
+    } catch (const std::exception &) {
+        continue;
+    }
+
+    UDPSocket receiver;
+    receiver.bind(Address("127.0.0.1", portnum));
+    receiver.set_blocking(false);
+    UDPSocket sender;
+
+    // read whatever arrives, until told to stop
+    std::vector<std::string> received;
+    bool listening = true;
+    loop.add_rule(
+        receiver, Direction::In, [&] { received.push_back(receiver.recv().payload); }, [&] { return listening; });
+
+    if (loop.wait_next_event(0) != EventLoop::Result::Timeout) {
+        throw std::runtime_error("event without a datagram");
+    }
+
+    sender.sendto(Address("127.0.0.1", portnum), std::string("hello"));
+    if (loop.wait_next_event(1000) != EventLoop::Result::Success || received != std::vector<std::string>{"hello"}) {
+        throw std::runtime_error("datagram not delivered");
+    }
+
+    // an uninterested rule is not serviced, and with nothing else to wait for the loop exits
+    sender.sendto(Address("127.0.0.1", portnum), std::string("ignored"));
+    listening = false;
+    if (loop.wait_next_event(0) != EventLoop::Result::Exit || received.size() != 1) {
+        throw std::runtime_error("uninterested rule serviced");
+    }
+
+    // the datagram is still there once interest returns
+    listening = true;
+    if (loop.wait_next_event(1000) != EventLoop::Result::Success || received.back() != "ignored") {
+        throw std::runtime_error("datagram lost while uninterested");
+    }
+}
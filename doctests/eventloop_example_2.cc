@@ -0,0 +1,23 @@
+// timers fire from wait_next_event, which sleeps no longer than the earliest one needs
+EventLoop loop;
+std::vector<int> fired;
+const uint64_t start = timestamp_ms();
+loop.add_timer(30, [&] { fired.push_back(30); });
+loop.add_timer(10, [&] { fired.push_back(10); });
+const auto canceled = loop.add_timer(20, [&] { fired.push_back(20); });
+loop.cancel_timer(canceled);
+
+// with no rules, the loop sleeps until a timer is due instead of exiting
+while (fired.size() < 2) {
+    if (loop.wait_next_event(-1) != EventLoop::Result::Success) {
+        throw std::runtime_error("no timer fired");
+    }
+}
+if (fired != std::vector<int>{10, 30} || timestamp_ms() - start < 30) {
+    throw std::runtime_error("timers fired in the wrong order or too early");
+}
+
+// with nothing left to wait for, the loop exits
+if (loop.wait_next_event(-1) != EventLoop::Result::Exit) {
+    throw std::runtime_error("loop did not exit");
+}
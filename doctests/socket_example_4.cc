@@ -0,0 +1,17 @@
+const uint16_t portnum = ((std::random_device()()) % 50000) + 1025;
+
+// create a UDP socket and bind it to a local address
+UDPSocket sock1;
+sock1.bind(Address("127.0.0.1", portnum));
+
+// send three datagrams with one system call
+UDPSocket sock2;
+sock2.sendto_batch(Address("127.0.0.1", portnum), {std::string("one"), std::string("two"), std::string("three")});
+
+// receive them with one system call, into storage that can be reused for the next batch
+std::vector<UDPSocket::received_datagram> batch(8, {{nullptr, 0}, ""});
+const size_t received = sock1.recv_batch(batch);
+
+if (received != 3 || batch[0].payload != "one" || batch[1].payload != "two" || batch[2].payload != "three") {
+    throw std::runtime_error("wrong data received");
+}
@@ -0,0 +1,29 @@
+const uint16_t portnum = ((std::random_device()()) % 50000) + 1025;
+
+// ask the kernel to coalesce datagrams arriving at this socket (if it can)
+UDPSocket sock1;
+sock1.bind(Address("127.0.0.1", portnum));
+const bool gro = sock1.set_gro();
+
+// send one buffer that the kernel splits into three 4-byte datagrams (if it can)
+UDPSocket sock2;
+if (sock2.gso_supported()) {
+    sock2.sendto_segmented(Address("127.0.0.1", portnum), std::string("one_two_six"), 4);
+} else {
+    sock2.sendto_batch(Address("127.0.0.1", portnum),
+                       {std::string("one_"), std::string("two_"), std::string("six")});
+}
+
+// receive: either one coalesced datagram (segment_size tells where each original datagram ends) or three
+std::string received;
+while (received.size() < 11) {
+    auto recvd = sock1.recv();
+    if (recvd.segment_size != 0 && (!gro || recvd.segment_size != 4)) {
+        throw std::runtime_error("wrong GRO segment size");
+    }
+    received += recvd.payload;
+}
+
+if (received != "one_two_six") {
+    throw std::runtime_error("wrong data received");
+}
@@ -0,0 +1,8 @@
+# The io_uring code (EventLoop::Backend::IoUring, TunTapFD::write_batch) needs Linux 5.17 or later headers
+include (CheckSymbolExists)
+check_symbol_exists (IOSQE_CQE_SKIP_SUCCESS "linux/io_uring.h" HAVE_IO_URING)
+if (HAVE_IO_URING)
+    add_definitions (-DHAVE_IO_URING)
+else ()
+    message (STATUS "linux/io_uring.h predates Linux 5.17: building without io_uring")
+endif ()
@@ -13,6 +13,7 @@ add_test(NAME t_recv_window          COMMAND recv_window)
 add_test(NAME t_recv_reorder         COMMAND recv_reorder)
 add_test(NAME t_recv_close           COMMAND recv_close)
 add_test(NAME t_recv_special         COMMAND recv_special)
+add_test(NAME t_recv_sack            COMMAND recv_sack)
 
 add_test(NAME t_send_connect         COMMAND send_connect)
 add_test(NAME t_send_transmit        COMMAND send_transmit)
@@ -21,6 +22,16 @@ add_test(NAME t_send_window          COMMAND send_window)
 add_test(NAME t_send_ack             COMMAND send_ack)
 add_test(NAME t_send_close           COMMAND send_close)
 add_test(NAME t_send_extra           COMMAND send_extra)
+add_test(NAME t_send_rtt             COMMAND send_rtt)
+add_test(NAME t_send_congestion      COMMAND send_congestion)
+add_test(NAME t_send_fast_retx       COMMAND send_fast_retx)
+add_test(NAME t_send_sack            COMMAND send_sack)
+add_test(NAME t_send_mss             COMMAND send_mss)
+add_test(NAME t_send_nagle           COMMAND send_nagle)
+
+add_test(NAME t_tcp_stack            COMMAND tcp_stack)
+add_test(NAME t_ring_stream          COMMAND ring_stream)
+add_test(NAME t_tcp_stack_tun        COMMAND tcp_stack_tun)
 
 add_test(NAME t_strm_reassem_single      COMMAND fsm_stream_reassembler_single)
 add_test(NAME t_strm_reassem_seq         COMMAND fsm_stream_reassembler_seq)
@@ -36,6 +47,8 @@ add_test(NAME t_byte_stream_one_write    COMMAND byte_stream_one_write)
 add_test(NAME t_byte_stream_two_writes   COMMAND byte_stream_two_writes)
 add_test(NAME t_byte_stream_capacity     COMMAND byte_stream_capacity)
 add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
+add_test(NAME t_byte_stream_ring         COMMAND byte_stream_ring)
+add_test(NAME t_strm_reassem_bitmap      COMMAND fsm_stream_reassembler_bitmap)
 
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
@@ -56,6 +69,11 @@ add_test(NAME t_connect              COMMAND fsm_connect_relaxed)
 add_test(NAME ec_listen              COMMAND fsm_listen)
 add_test(NAME t_listen               COMMAND fsm_listen_relaxed)
 add_test(NAME t_winsize              COMMAND fsm_winsize)
+add_test(NAME t_delayed_ack          COMMAND fsm_delayed_ack)
+add_test(NAME t_sack                 COMMAND fsm_sack)
+add_test(NAME t_window_scale         COMMAND fsm_window_scale)
+add_test(NAME t_mss                  COMMAND fsm_mss)
+add_test(NAME t_nagle                COMMAND fsm_nagle)
 add_test(NAME ec_retx                COMMAND fsm_retx)
 add_test(NAME t_retx                 COMMAND fsm_retx_relaxed)
 add_test(NAME t_retx_win             COMMAND fsm_retx_win)
@@ -66,6 +84,7 @@ add_test(NAME t_reorder              COMMAND fsm_reorder)
 add_test(NAME t_address_dt           COMMAND address_dt)
 add_test(NAME t_parser_dt            COMMAND parser_dt)
 add_test(NAME t_socket_dt            COMMAND socket_dt)
+add_test(NAME t_eventloop_dt         COMMAND eventloop_dt)
 
 add_test(NAME t_udp_client_send      COMMAND "${PROJECT_SOURCE_DIR}/txrx.sh" -ucS)
 add_test(NAME t_udp_server_send      COMMAND "${PROJECT_SOURCE_DIR}/txrx.sh" -usS)
@@ -0,0 +1,121 @@
+#include "bitmap_stream_reassembler.hh"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t WORD_BITS = 64;
+
+//! bits [lo, hi) of a word, 0 <= lo < hi <= 64
+uint64_t word_mask(const size_t lo, const size_t hi) {
+    const uint64_t upto_hi = hi == WORD_BITS ? ~uint64_t{0} : (uint64_t{1} << hi) - 1;
+    return upto_hi & ~((uint64_t{1} << lo) - 1);
+}
+
+}  // namespace
+
+BitmapStreamReassembler::BitmapStreamReassembler(const size_t capacity)
+    : _output(capacity, ByteStream::Backend::Ring)
+    , _capacity(capacity)
+    , _ring(capacity, 0)
+    , _bitmap((capacity + WORD_BITS - 1) / WORD_BITS, 0) {}
+
+//  一次处理一个64位的字, 而非一个字节
+size_t BitmapStreamReassembler::set_bits(const size_t from, const size_t to) {
+    size_t newly_set = 0;
+    for (size_t pos = from; pos < to;) {
+        const size_t lo = pos % WORD_BITS;
+        const size_t hi = min(WORD_BITS, lo + (to - pos));
+        uint64_t &word = _bitmap[pos / WORD_BITS];
+        const uint64_t mask = word_mask(lo, hi);
+        newly_set += __builtin_popcountll(mask & ~word);  //  只统计之前没到过的字节, 重复的字节不计数
+        word |= mask;
+        pos += hi - lo;
+    }
+    return newly_set;
+}
+
+void BitmapStreamReassembler::clear_bits(const size_t from, const size_t to) {
+    for (size_t pos = from; pos < to;) {
+        const size_t lo = pos % WORD_BITS;
+        const size_t hi = min(WORD_BITS, lo + (to - pos));
+        _bitmap[pos / WORD_BITS] &= ~word_mask(lo, hi);
+        pos += hi - lo;
+    }
+}
+
+//  从from开始数连续的1: 对取反后的字做ctz, 整字全1时一次跳过64位
+size_t BitmapStreamReassembler::count_present(const size_t from, const size_t max_len) const {
+    size_t len = 0;
+    size_t pos = from;
+    while (len < max_len) {
+        const size_t bit = pos % WORD_BITS;
+        const size_t avail = min(WORD_BITS - bit, _capacity - pos);  //  本字中属于ring的位数
+        const uint64_t holes = ~_bitmap[pos / WORD_BITS] >> bit;
+        const size_t ones = min(holes == 0 ? WORD_BITS - bit : static_cast<size_t>(__builtin_ctzll(holes)), avail);
+        len += ones;
+        if (ones < avail) {
+            break;
+        }
+        pos += ones;
+        if (pos == _capacity) {
+            pos = 0;
+        }
+    }
+    return min(len, max_len);
+}
+
+//  窗口长度 <= _capacity, 所以窗口内的下标对 _capacity 取模不会冲突; 最多拆成两段(绕回)
+void BitmapStreamReassembler::store(const string_view data, const size_t index) {
+    const size_t pos = index % _capacity;
+    const size_t first = min(data.size(), _capacity - pos);
+    memcpy(&_ring[pos], data.data(), first);
+    memcpy(&_ring[0], data.data() + first, data.size() - first);
+    _unassembled += set_bits(pos, pos + first);
+    _unassembled += set_bits(0, data.size() - first);
+}
+
+//  把ring中从first_unassembled()开始的连续字节直接写进_output (最多两次write, 无中间拷贝)
+void BitmapStreamReassembler::assemble() {
+    const size_t pos = first_unassembled() % _capacity;
+    const size_t len = count_present(pos, _unassembled);
+    if (len == 0) {
+        return;
+    }
+    const size_t first = min(len, _capacity - pos);
+    _output.write(string_view(&_ring[pos], first));
+    _output.write(string_view(_ring.data(), len - first));
+    clear_bits(pos, pos + first);
+    clear_bits(0, len - first);
+    _unassembled -= len;
+}
+
+//  不需要像StreamReassembler那样持有data的存储, 所以string和Buffer都只是借出一个view
+void BitmapStreamReassembler::push_substring(const string &data, const uint64_t index, const bool eof) {
+    push_view(data, index, eof);
+}
+
+void BitmapStreamReassembler::push_substring(const Buffer &data, const uint64_t index, const bool eof) {
+    push_view(data.str(), index, eof);
+}
+
+void BitmapStreamReassembler::push_view(const string_view data, const uint64_t index, const bool eof) {
+    if (eof) {
+        _eof = true;
+        _eof_idx = index + data.size();
+    }
+
+    const size_t start = max(index, first_unassembled());
+    const size_t end = min(index + data.size(), first_unacceptable());
+    if (start < end) {
+        store(data.substr(start - index, end - start), start);
+        assemble();
+    }
+
+    if (_eof && _eof_idx <= first_unassembled()) {
+        _output.end_input();
+    }
+}
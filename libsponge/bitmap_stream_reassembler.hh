@@ -0,0 +1,82 @@
+#ifndef SPONGE_LIBSPONGE_BITMAP_STREAM_REASSEMBLER_HH
+#define SPONGE_LIBSPONGE_BITMAP_STREAM_REASSEMBLER_HH
+
+#include "byte_stream.hh"
+#include "util/buffer.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief A StreamReassembler that keeps unassembled bytes in a fixed ring plus a presence bitmap.
+//!
+//! \details Same interface as StreamReassembler. The byte with stream index `i` lives at
+//! `i % capacity` of a preallocated ring, and bit `i % capacity` of the bitmap says whether it has
+//! arrived. A fragment is one memcpy into the ring and a few word-wide OR's into the bitmap; no
+//! per-fragment allocation, and duplicates cost nothing extra. The contiguous prefix is found by
+//! scanning the bitmap 64 bits at a time and handed to the output stream straight from the ring.
+class BitmapStreamReassembler {
+  private:
+    ByteStream _output;  //!< The reassembled in-order byte stream
+    size_t _capacity;    //!< The maximum number of bytes
+
+    std::string _ring;              //!< `_capacity` bytes, indexed by stream index modulo `_capacity`
+    std::vector<uint64_t> _bitmap;  //!< bit `i` set iff `_ring[i]` holds an unassembled byte
+
+    size_t _eof_idx{0};
+    bool _eof{false};
+    size_t _unassembled{0};  //!< number of set bits in `_bitmap`
+
+    size_t first_unacceptable() const { return _output.bytes_read() + _capacity; }
+
+    //! Mark ring positions [from, to) (no wraparound) present
+    //! \returns how many of them were not present before
+    size_t set_bits(const size_t from, const size_t to);
+
+    //! Mark ring positions [from, to) (no wraparound) absent
+    void clear_bits(const size_t from, const size_t to);
+
+    //! \returns the number of consecutive present positions starting at ring position `from`
+    //! (wrapping around), at most `max_len`
+    size_t count_present(const size_t from, const size_t max_len) const;
+
+    //! Copy `data` into the ring and the bitmap at stream index `index` (already clipped to the window)
+    void store(const std::string_view data, const size_t index);
+
+    //! Write the bytes starting at first_unassembled() (if any) into the output stream
+    void assemble();
+
+    //! Shared body of the push_substring() overloads
+    void push_view(const std::string_view data, const uint64_t index, const bool eof);
+
+  public:
+    //! \brief Construct a `BitmapStreamReassembler` that will store up to `capacity` bytes.
+    //! \note This capacity limits both the bytes that have been reassembled,
+    //! and those that have not yet been reassembled.
+    BitmapStreamReassembler(const size_t capacity);
+
+    //! \brief Receive a substring and write any newly contiguous bytes into the stream.
+    //! \details Bytes that would exceed the capacity are silently discarded.
+    void push_substring(const std::string &data, const uint64_t index, const bool eof);
+
+    //! \brief Receive a substring held in a Buffer (e.g. a segment's payload)
+    void push_substring(const Buffer &data, const uint64_t index, const bool eof);
+
+    //! \name Access the reassembled byte stream
+    //!@{
+    const ByteStream &stream_out() const { return _output; }
+    ByteStream &stream_out() { return _output; }
+    //!@}
+
+    //! The number of bytes in the substrings stored but not yet reassembled
+    size_t unassembled_bytes() const { return _unassembled; }
+
+    //! \brief Is the internal state empty (other than the output stream)?
+    bool empty() const { return _unassembled == 0; }
+
+    size_t window_size() const { return _capacity + _output.bytes_read() - _output.bytes_written(); }
+
+    size_t first_unassembled() const { return _output.bytes_written(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_BITMAP_STREAM_REASSEMBLER_HH
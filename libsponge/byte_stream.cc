@@ -1,6 +1,7 @@
 #include "byte_stream.hh"
 
 #include <cassert>
+#include <cstring>
 // Dummy implementation of a flow-controlled in-memory byte stream.
 
 // For Lab 0, please replace with a real implementation that passes the
@@ -20,11 +21,34 @@ void DUMMY_CODE(Targs &&.../* unused */) {}
 
 using namespace std;
 
-ByteStream::ByteStream(const size_t capacity)
-    : _stream(), _capacity(capacity), _bytes_popped(0), _bytes_pushed(0), _end(false) {
+//! \param[in] capacity the maximum number of bytes the stream buffers at once
+//! \param[in] backend Backend::Ring preallocates `capacity` bytes up front so that peeks never
+//!                    have to walk or concatenate the buffered writes
+ByteStream::ByteStream(const size_t capacity, const Backend backend)
+    : _backend(backend)
+    , _stream()
+    , _ring(backend == Backend::Ring ? capacity : 0, '\0')
+    , _ring_head(0)
+    , _capacity(capacity)
+    , _bytes_popped(0)
+    , _bytes_pushed(0)
+    , _end(false) {}
+
+//  ring中 [_ring_head, _ring_head + len) 可能绕过末尾, 故最多分成两段
+pair<string_view, string_view> ByteStream::ring_spans(const size_t len) const {
+    const size_t first_len = min(len, _capacity - _ring_head);
+    return {string_view(_ring.data() + _ring_head, first_len), string_view(_ring.data(), len - first_len)};
 }
 
 
+//  直接拷贝进ring的空闲区域(写指针之后), 绕过末尾时分两次拷贝. 调用者保证data放得下
+void ByteStream::ring_write(const string_view data) {
+    const size_t tail = (_ring_head + buffer_size()) % _capacity;
+    const size_t first_len = min(data.size(), _capacity - tail);
+    memcpy(_ring.data() + tail, data.data(), first_len);
+    memcpy(_ring.data(), data.data() + first_len, data.size() - first_len);
+}
+
 //  如果外界传参传的是个临时量或者char，则传参还会有一次拷贝. 
 //  原先StreamReassembler(unordered_map<size_t,char>)调用write时只能传递char，故每个char在传参的时候都会拷贝一次，这个const &就跟直接传值一样。那么对于一个大字符串，每个字符都要拷贝一次。
 //      为什么原先只能传递char 不能传递string呢? 因为原先是以char为单元来对窗口进行维护的，也没有维护哪些字符连续，只能边遍历边传unordered_map里的字符char拷贝给write.
@@ -48,48 +72,151 @@ ByteStream::ByteStream(const size_t capacity)
     //  现在的策略，采用map<i,string>，对于缓存的char，会以块的方式维护（因为底层用的是string），可以维护哪些字符是连在一起的，这样调用write的时候不必1个char1个char的遍历、write。
     //  且不会重复缓存已经缓存过的char! 每个char只会缓存一次. 也即 每个char只会加到 receive_window中一次!
 
-size_t ByteStream::write(const string &data) {
+size_t ByteStream::write(const string &data) { return write(string_view(data)); }
+
+size_t ByteStream::write(const string_view data) {
     
     assert(!input_ended());     //  如果写端被关闭，则外界不应当对stream进行write。
 
-    size_t bytes_to_write = min(data.size(), _capacity - _stream.size());   //  最多写多少bytes
+    size_t bytes_to_write = min(data.size(), remaining_capacity());   //  最多写多少bytes
+    if (bytes_to_write == 0)
+        return 0;
+
+    if (_backend == Backend::Ring) {
+        ring_write(data.substr(0, bytes_to_write));
+    } else {
+        // for (size_t i = 0; i < bytes_to_write; ++i) {
+            // _stream.push_back(data[i]);
+        // }
+        //  拷贝一次 ; 然后 move到_stream中
+        _stream.append(string(data.substr(0, bytes_to_write)));
+    }
+    _bytes_pushed += bytes_to_write;
+
+    return bytes_to_write;
+}
+
+//! \details With Backend::BufferList the string is kept as-is (truncated in place if it does not fit),
+//! so the bytes are not copied; Backend::Ring copies them into the ring.
+size_t ByteStream::write(string &&data) {
+    if (_backend == Backend::Ring) {
+        return write(static_cast<const string &>(data));
+    }
+    return write(Buffer(move(data)));
+}
+
+//! \details With Backend::BufferList the Buffer's storage is shared (and narrowed if it does not fit),
+//! so the bytes are not copied; Backend::Ring copies them into the ring.
+size_t ByteStream::write(Buffer data) {
+    assert(!input_ended());
+
+    size_t bytes_to_write = min(data.size(), remaining_capacity());
+    if (bytes_to_write == 0)
+        return 0;
+
+    if (_backend == Backend::Ring) {
+        ring_write(data.str().substr(0, bytes_to_write));
+    } else {
+        data.remove_suffix(data.size() - bytes_to_write);
+        _stream.append(data);
+    }
     _bytes_pushed += bytes_to_write;
-    // for (size_t i = 0; i < bytes_to_write; ++i) {
-        // _stream.push_back(data[i]);
-    // }
-    //  substr copy 一次 ; 然后 move到_stream中
-    _stream.append(std::move(data.substr(0,bytes_to_write)));
 
     return bytes_to_write;
 }
 
 //! \param[in] len bytes will be copied from the output side of the buffer
+//! \note Only the requested bytes are copied, not the whole buffer
 string ByteStream::peek_output(const size_t len) const {
-    assert(_stream.size() <= _capacity);
+    assert(buffer_size() <= _capacity);
 
-    size_t bytes_to_read = min(len, _stream.size());
+    size_t bytes_to_read = min(len, buffer_size());
     // string res;
     // for (deque<char>::const_iterator iter = _stream.begin(); (bytes_to_read-- > 0) && iter != _stream.end(); ++iter) {
     //     // cout<<*iter;
     //     res.push_back(*iter);
     // }
     // return res;
-    string s(_stream.concatenate());
-    return s.substr(0,bytes_to_read);
+    //  原先是 _stream.concatenate().substr(0,bytes_to_read) : 每次peek都要拷贝整个buffer
+    string res;
+    res.reserve(bytes_to_read);
+    if (_backend == Backend::Ring) {
+        const auto [first, second] = ring_spans(bytes_to_read);
+        res.append(first).append(second);
+        return res;
+    }
+    for (const auto &buf : _stream.buffers()) {
+        if (res.size() == bytes_to_read)
+            break;
+        res.append(buf.str().substr(0, bytes_to_read - res.size()));
+    }
+    return res;
     // return string(_stream.begin(),_stream.begin()+bytes_to_read);
 }
 
+//! \param[in] len bytes will be exposed from the output side of the buffer
+//! \details With Backend::Ring the result holds at most two views; with Backend::BufferList it holds
+//! one view per buffered write that overlaps the first `len` bytes.
+BufferViewList ByteStream::peek_views(const size_t len) const {
+    size_t bytes_to_read = min(len, buffer_size());
+    BufferViewList views;
+    if (_backend == Backend::Ring) {
+        const auto [first, second] = ring_spans(bytes_to_read);
+        views.append(first);
+        views.append(second);
+        return views;
+    }
+
+    for (const auto &buf : _stream.buffers()) {
+        if (bytes_to_read == 0)
+            break;
+        const string_view view = buf.str().substr(0, bytes_to_read);
+        views.append(view);
+        bytes_to_read -= view.size();
+    }
+    return views;
+}
+
+
+//! \param[in] len bytes will be sliced from the output side of the buffer
+//! \details With Backend::BufferList no bytes are copied: each returned Buffer is a narrowed copy
+//! of a buffered write and keeps its storage alive after the bytes are popped.
+BufferList ByteStream::peek_buffers(const size_t len) const {
+    size_t bytes_to_read = min(len, buffer_size());
+    if (_backend == Backend::Ring) {
+        return BufferList(peek_output(bytes_to_read));
+    }
+
+    BufferList res;
+    for (const auto &buf : _stream.buffers()) {
+        if (bytes_to_read == 0)
+            break;
+        Buffer slice{buf};
+        if (slice.size() > bytes_to_read) {
+            slice.remove_suffix(slice.size() - bytes_to_read);
+        }
+        bytes_to_read -= slice.size();
+        res.append(slice);
+    }
+    return res;
+}
 
 //! \param[in] len bytes will be removed from the output side of the buffer
 void ByteStream::pop_output(const size_t len) {
-    assert(_stream.size() <= _capacity);
+    assert(buffer_size() <= _capacity);
     
-    size_t bytes_to_pop = min(len, _stream.size());  //  最多全部弹出
+    size_t bytes_to_pop = min(len, buffer_size());  //  最多全部弹出
+    if (bytes_to_pop == 0)
+        return;
     _bytes_popped += bytes_to_pop;
     // while (bytes_to_pop--) {
     //     _stream.pop_front();
     // }
-    _stream.remove_prefix(bytes_to_pop);
+    if (_backend == Backend::Ring) {
+        _ring_head = (_ring_head + bytes_to_pop) % _capacity;
+    } else {
+        _stream.remove_prefix(bytes_to_pop);
+    }
 }
 
 //! Read (i.e., copy and then pop) the next "len" bytes of the stream
@@ -97,32 +224,41 @@ void ByteStream::pop_output(const size_t len) {
 //! \returns a string
 std::string ByteStream::read(const size_t len) {
     // DUMMY_CODE(len);
-    assert(_stream.size() <= _capacity);
+    assert(buffer_size() <= _capacity);
     string res(peek_output(len));
     pop_output(len);
     return res;
 }
 
+//! \param[in] len bytes will be popped and returned
+//! \returns a BufferList that shares storage with the stream where possible
+BufferList ByteStream::read_buffers(const size_t len) {
+    BufferList res(peek_buffers(len));
+    pop_output(len);
+    return res;
+}
+
 //  关闭input端
 void ByteStream::end_input() { _end = true; }
 
 //  input写端是否被关闭
 bool ByteStream::input_ended() const { return _end; }
 //  当前_stream中还有多少bytes未读出
-size_t ByteStream::buffer_size() const { return _stream.size(); }
+//  不必遍历BufferList求size : 压入的 - 弹出的 即可
+size_t ByteStream::buffer_size() const { return _bytes_pushed - _bytes_popped; }
 
 // bool ByteStream::buffer_empty() const { return _stream.empty(); }
-bool ByteStream::buffer_empty() const { return _stream.size() == 0; }
+bool ByteStream::buffer_empty() const { return buffer_size() == 0; }
 
 
 //  遇见eof : input关闭，且_stream中无数据
 // bool ByteStream::eof() const { return _end && _stream.empty(); }
-bool ByteStream::eof() const { return _end && _stream.size() == 0; }
+bool ByteStream::eof() const { return _end && buffer_empty(); }
 
 //  总共有多少bytes压入到_stream中过
 size_t ByteStream::bytes_written() const { return _bytes_pushed; }
 //  _stream中总共有过多少bytes流出
 size_t ByteStream::bytes_read() const { return _bytes_popped; }
 
-size_t ByteStream::remaining_capacity() const { return _capacity - _stream.size(); }
+size_t ByteStream::remaining_capacity() const { return _capacity - buffer_size(); }
 
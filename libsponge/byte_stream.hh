@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
 #include <string>
+#include <string_view>
 #include <queue>
 #include <deque>
 #include "buffer.hh"
@@ -14,6 +15,13 @@ using std::deque;
 //! side.  The byte stream is finite: the writer can end the input,
 //! and then no more bytes can be written.
 class ByteStream {
+  public:
+    //! \brief Storage used to hold the buffered bytes, chosen at construction
+    enum class Backend {
+        BufferList,  //!< A queue of reference-counted strings, one per write()
+        Ring,        //!< A preallocated contiguous ring of `capacity` bytes
+    };
+
   private:
     // Your code here -- add private members as necessary.
 
@@ -25,14 +33,24 @@ class ByteStream {
     bool _error{};  //!< Flag indicating that the stream suffered an error.
 
     // deque<char> _stream;     //  其实就是个pipe
-    BufferList _stream;
+    Backend _backend;
+    BufferList _stream;      //  Backend::BufferList 的存储
+    std::string _ring;       //  Backend::Ring 的存储, 大小恒为 _capacity
+    size_t _ring_head;       //  _ring 中第一个未读字节的下标
     size_t _capacity;        //  流中最多容纳多少bytes
     size_t _bytes_popped;    //  有多少bytes从流中弹出
     size_t _bytes_pushed;    //  有多少bytes被压入流中
     bool _end;               //  _stream写端是否被关闭
+
+    //! The (at most two) contiguous regions of `_ring` holding the next `len` buffered bytes
+    std::pair<std::string_view, std::string_view> ring_spans(const size_t len) const;
+
+    //! Copy `data` into the free space of `_ring` (caller checks that it fits)
+    void ring_write(const std::string_view data);
+
   public:
     //! Construct a stream with room for `capacity` bytes.
-    ByteStream(const size_t capacity);
+    ByteStream(const size_t capacity, const Backend backend = Backend::BufferList);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -42,6 +60,22 @@ class ByteStream {
     //! \returns the number of bytes accepted into the stream
     size_t write(const std::string &data);
 
+    //! Write bytes held elsewhere (e.g. in a reassembler's ring) into the stream
+    //! \returns the number of bytes accepted into the stream
+    size_t write(const std::string_view data);
+
+    //! Write a C string into the stream (resolves the string/string_view ambiguity for literals)
+    //! \returns the number of bytes accepted into the stream
+    size_t write(const char *data) { return write(std::string_view(data)); }
+
+    //! Write a string of bytes into the stream, taking ownership of its storage
+    //! \returns the number of bytes accepted into the stream
+    size_t write(std::string &&data);
+
+    //! Write a Buffer into the stream, sharing its storage instead of copying
+    //! \returns the number of bytes accepted into the stream
+    size_t write(Buffer data);
+
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
 
@@ -59,6 +93,15 @@ class ByteStream {
     //! \returns a string
     std::string peek_output(const size_t len) const;
 
+    //! Peek at next "len" bytes of the stream without copying them
+    //! \returns views that stay valid until the next write() or pop_output()
+    BufferViewList peek_views(const size_t len) const;
+
+    //! Peek at next "len" bytes of the stream as Buffer slices
+    //! \returns Buffers sharing storage with the stream (Backend::BufferList),
+    //! or a single Buffer holding a copy (Backend::Ring)
+    BufferList peek_buffers(const size_t len) const;
+
     //! Remove bytes from the buffer
     void pop_output(const size_t len);
 
@@ -66,6 +109,10 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read (i.e., slice and then pop) the next "len" bytes of the stream
+    //! \returns a BufferList, see peek_buffers()
+    BufferList read_buffers(const size_t len);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -80,6 +127,9 @@ class ByteStream {
 
     //! \returns `true` if the output has reached the ending
     bool eof() const;
+
+    //! \returns the storage backend chosen at construction
+    Backend backend() const { return _backend; }
     //!@}
 
     //! \name General accounting
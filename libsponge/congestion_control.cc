@@ -0,0 +1,136 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+CongestionControl::CongestionControl(const size_t mss)
+    : _mss(mss), _cwnd(10 * mss), _ssthresh(numeric_limits<size_t>::max()) {}
+
+size_t CongestionControl::half_flight(const size_t bytes_in_flight) const {
+    return max(bytes_in_flight / 2, 2 * _mss);
+}
+
+void CongestionControl::on_timeout(const size_t bytes_in_flight) {
+    _ssthresh = half_flight(bytes_in_flight);
+    _cwnd = _mss;
+}
+
+//  RFC 5681 (3.2) 步骤2, 3: 重传的seg和之后收到的3个dup ack对应的seg都已离开网络
+void CongestionControl::on_fast_retransmit(const size_t bytes_in_flight) {
+    _ssthresh = half_flight(bytes_in_flight);
+    _cwnd = _ssthresh + 3 * _mss;
+}
+
+//  RFC 6582 (3.2) 步骤5: 减去新确认的字节数, 若确认了至少一个SMSS则加回一个SMSS
+void CongestionControl::on_partial_ack(const size_t acked) {
+    _cwnd -= min(acked, _cwnd - _mss);
+    if (acked >= _mss) {
+        _cwnd += _mss;
+    }
+}
+
+unique_ptr<CongestionControl> CongestionControl::make(const CongestionControlAlgorithm algorithm, const size_t mss) {
+    switch (algorithm) {
+        case CongestionControlAlgorithm::Reno:
+            return make_unique<RenoCongestionControl>(mss);
+        case CongestionControlAlgorithm::Cubic:
+            return make_unique<CubicCongestionControl>(mss);
+        case CongestionControlAlgorithm::None:
+            break;
+    }
+    return nullptr;
+}
+
+//  slow start : 每ack一个segment的数据, cwnd增加至多一个SMSS (RFC 5681 (2))
+//  congestion avoidance : 每ack一个cwnd的数据, cwnd增加一个SMSS (即每个RTT加一个SMSS, appropriate byte counting)
+void RenoCongestionControl::on_ack(const size_t acked, const uint64_t, const uint64_t) {
+    if (in_slow_start()) {
+        _cwnd += min(acked, _mss);
+        return;
+    }
+    _acked_in_avoidance += acked;
+    if (_acked_in_avoidance >= _cwnd) {
+        _acked_in_avoidance -= _cwnd;
+        _cwnd += _mss;
+    }
+}
+
+void RenoCongestionControl::on_timeout(const size_t bytes_in_flight) {
+    CongestionControl::on_timeout(bytes_in_flight);
+    _acked_in_avoidance = 0;
+}
+
+void RenoCongestionControl::on_fast_retransmit(const size_t bytes_in_flight) {
+    CongestionControl::on_fast_retransmit(bytes_in_flight);
+    _acked_in_avoidance = 0;
+}
+
+void CubicCongestionControl::start_epoch(const uint64_t now_ms) {
+    const double w = static_cast<double>(_cwnd) / _mss;
+    _epoch_started = true;
+    _epoch_start_ms = now_ms;
+    _acked_in_avoidance = 0;
+    if (w < _w_max) {
+        _k = cbrt((_w_max - w) / C);
+    } else {
+        _k = 0;
+        _w_max = w;
+    }
+    _w_est = w;
+}
+
+//  RFC 8312 (4.1) - (4.5), 窗口以segment为单位计算
+void CubicCongestionControl::on_ack(const size_t acked, const uint64_t now_ms, const uint64_t srtt_ms) {
+    if (in_slow_start()) {
+        _cwnd += min(acked, _mss);
+        return;
+    }
+    if (!_epoch_started) {
+        start_epoch(now_ms);
+    }
+
+    const double w = static_cast<double>(_cwnd) / _mss;
+    //  W_cubic(t + RTT): 一个RTT之后窗口应当达到的大小
+    const double t = static_cast<double>(now_ms - _epoch_start_ms + srtt_ms) / 1000;
+    double target = C * pow(t - _k, 3) + _w_max;
+
+    //  TCP-friendly region : 不比同样条件下的Reno增长得慢
+    _w_est += 3 * (1 - BETA) / (1 + BETA) * (static_cast<double>(acked) / _mss) / w;
+    target = max(target, _w_est);
+    target = min(target, 1.5 * w);
+
+    if (target <= w) {
+        return;
+    }
+    //  每ack cwnd / (target - cwnd) 个segment, cwnd增加一个segment
+    _acked_in_avoidance += acked;
+    const double acked_per_increment = w / (target - w) * _mss;
+    if (static_cast<double>(_acked_in_avoidance) >= acked_per_increment) {
+        _acked_in_avoidance = 0;
+        _cwnd += _mss;
+    }
+}
+
+//  RFC 8312 (4.6) (4.7): fast convergence, ssthresh = cwnd * beta
+void CubicCongestionControl::reduce() {
+    const double w = static_cast<double>(_cwnd) / _mss;
+    _w_max = w < _w_max ? w * (1 + BETA) / 2 : w;
+    _ssthresh = max(static_cast<size_t>(static_cast<double>(_cwnd) * BETA), 2 * _mss);
+    _epoch_started = false;
+    _acked_in_avoidance = 0;
+}
+
+//  超时 : 从一个segment重新slow start
+void CubicCongestionControl::on_timeout(const size_t /* bytes_in_flight */) {
+    reduce();
+    _cwnd = _mss;
+}
+
+//  fast recovery 与Reno相同, 只是ssthresh按beta而非一半减小
+void CubicCongestionControl::on_fast_retransmit(const size_t /* bytes_in_flight */) {
+    reduce();
+    _cwnd = _ssthresh + 3 * _mss;
+}
@@ -0,0 +1,110 @@
+#ifndef SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
+#define SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
+
+#include "tcp_config.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//! \brief Congestion window policy of a TCPSender
+//!
+//! \details The TCPSender never has more than `min(cwnd(), receiver's window)` bytes in flight.
+//! It reports every acknowledgment of new data and every retransmission timeout; the policy
+//! decides how the window grows (slow start, congestion avoidance) and shrinks (multiplicative
+//! decrease). Byte counts are in sequence space, like TCPSender::bytes_in_flight().
+class CongestionControl {
+  protected:
+    size_t _mss;       //!< sender maximum segment size
+    size_t _cwnd;      //!< congestion window
+    size_t _ssthresh;  //!< slow start threshold
+
+    bool in_slow_start() const { return _cwnd < _ssthresh; }
+
+    //! RFC 5681 (4): ssthresh = max(FlightSize / 2, 2 * SMSS)
+    size_t half_flight(const size_t bytes_in_flight) const;
+
+  public:
+    //! RFC 6928 initial window of 10 segments, unbounded ssthresh
+    explicit CongestionControl(const size_t mss);
+    virtual ~CongestionControl() = default;
+
+    CongestionControl(const CongestionControl &) = default;
+    CongestionControl &operator=(const CongestionControl &) = default;
+
+    //! \brief `acked` bytes of new data were acknowledged at time `now_ms`
+    //! \param srtt_ms smoothed RTT, or 0 if the sender does not estimate it
+    virtual void on_ack(const size_t acked, const uint64_t now_ms, const uint64_t srtt_ms) = 0;
+
+    //! \brief The retransmission timer expired with `bytes_in_flight` outstanding
+    //! \details RFC 5681 (4): ssthresh = max(FlightSize / 2, 2 * SMSS), cwnd = 1 segment
+    virtual void on_timeout(const size_t bytes_in_flight);
+
+    //! \name Fast recovery (RFC 5681 (3.2), RFC 6582)
+    //!@{
+
+    //! \brief Third duplicate ACK with `bytes_in_flight` outstanding: the oldest segment is retransmitted
+    //! \details ssthresh = max(FlightSize / 2, 2 * SMSS), cwnd = ssthresh + 3 * SMSS
+    virtual void on_fast_retransmit(const size_t bytes_in_flight);
+
+    //! \brief Another duplicate ACK during recovery: one more segment has left the network
+    void on_dup_ack() { _cwnd += _mss; }
+
+    //! \brief `acked` bytes of new data were acknowledged, but not everything outstanding when recovery began
+    void on_partial_ack(const size_t acked);
+
+    //! \brief Everything outstanding when recovery began was acknowledged: deflate the window
+    void on_recovery_exit() { _cwnd = _ssthresh; }
+    //!@}
+
+    //! \name Accessors
+    //!@{
+    size_t cwnd() const { return _cwnd; }
+    size_t ssthresh() const { return _ssthresh; }
+    //!@}
+
+    //! \brief The policy selected by `algorithm`, or nullptr for CongestionControlAlgorithm::None
+    static std::unique_ptr<CongestionControl> make(const CongestionControlAlgorithm algorithm, const size_t mss);
+};
+
+//! \brief Slow start, additive increase of one segment per RTT, halving on loss (RFC 5681)
+class RenoCongestionControl : public CongestionControl {
+  private:
+    size_t _acked_in_avoidance{0};  //!< bytes acked since cwnd last grew in congestion avoidance
+
+  public:
+    using CongestionControl::CongestionControl;
+
+    void on_ack(const size_t acked, const uint64_t now_ms, const uint64_t srtt_ms) override;
+    void on_timeout(const size_t bytes_in_flight) override;
+    void on_fast_retransmit(const size_t bytes_in_flight) override;
+};
+
+//! \brief CUBIC (RFC 8312): after a loss the window follows a cubic function of the time since
+//! the loss, independent of RTT, with Reno's growth as a floor (the "TCP-friendly region")
+class CubicCongestionControl : public CongestionControl {
+  private:
+    static constexpr double C = 0.4;     //!< scaling constant, in segments / s^3
+    static constexpr double BETA = 0.7;  //!< multiplicative decrease factor
+
+    double _w_max{0};             //!< window (in segments) just before the last reduction
+    double _k{0};                 //!< seconds the cubic takes to grow back to `_w_max`
+    double _w_est{0};             //!< Reno-equivalent window (in segments) for the TCP-friendly region
+    bool _epoch_started{false};   //!< whether `_epoch_start_ms` is valid
+    uint64_t _epoch_start_ms{0};  //!< start of the current congestion avoidance epoch
+    size_t _acked_in_avoidance{0};
+
+    //! Enter a new epoch at `now_ms` from the current window
+    void start_epoch(const uint64_t now_ms);
+    //! Multiplicative decrease of ssthresh on loss, remembering the window in `_w_max`
+    void reduce();
+
+  public:
+    using CongestionControl::CongestionControl;
+
+    void on_ack(const size_t acked, const uint64_t now_ms, const uint64_t srtt_ms) override;
+    void on_timeout(const size_t bytes_in_flight) override;
+    void on_fast_retransmit(const size_t bytes_in_flight) override;
+};
+
+#endif  // SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
@@ -3,6 +3,7 @@
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
 
+#include <algorithm>
 #include <iostream>
 
 // Dummy implementation of a network interface
@@ -174,6 +175,23 @@ void NetworkInterface::tick(const size_t ms_since_last_tick) {
     }
 }
 
+//  最早过期的ARP表项, 或最早可以重发的ARP请求
+std::optional<size_t> NetworkInterface::next_timeout() const {
+    std::optional<size_t> next{};
+    const auto earliest = [&next](const int remaining) {
+        if (remaining > 0) {
+            next = next.has_value() ? std::min(*next, size_t(remaining)) : size_t(remaining);
+        }
+    };
+    for (const auto &entry : _arp_table) {
+        earliest(entry.second.second);
+    }
+    for (const auto &waiting_item : _wait_for_req) {
+        earliest(waiting_item.second);
+    }
+    return next;
+}
+
 //  构造ARP查询分组
 ARPMessage NetworkInterface::buildArpRequest(uint32_t target_ip_address) {
     ARPMessage req;                           //  arp查询分组
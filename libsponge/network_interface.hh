@@ -80,6 +80,9 @@ class NetworkInterface {
 
     //! \brief Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
+
+    //! \brief Milliseconds until an ARP mapping expires or an ARP request may be repeated, if either is pending
+    std::optional<size_t> next_timeout() const;
 };
 
 #endif  // SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
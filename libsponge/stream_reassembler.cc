@@ -22,7 +22,7 @@ void DUMMY_CODE(Targs &&.../* unused */) {}
 using namespace std;
 
 StreamReassembler::StreamReassembler(const size_t capacity)
-    : _output(capacity)
+    : _output(capacity, ByteStream::Backend::Ring)     //  reader会频繁peek, 用ring避免每次peek都拷贝整个buffer
     , _capacity(capacity)
     , _receving_window()
     , _eof_idx(0)
@@ -34,161 +34,144 @@ StreamReassembler::StreamReassembler(const size_t capacity)
 //! contiguous substrings and writes them into the output stream in order.
 //  合法data : empty || not empty
 void StreamReassembler::push_substring(const string &data, const size_t index, const bool eof) {
+    push_substring(Buffer(string(data)), index, eof);
+}
 
-//   约定 data的前串prev_data 为 prev_data的起始idx比data的起始idx小 ; 同理 data的 后串 next_data为 next_data的起始idx比data的起始idx大
-//   1. 获取当前 index 在 receive_window 中的前串
-//      a. 如果存在前串，则判断是否存在重复区域。如果存在部分重复则截断，存在全部重复则直接丢弃。
-//      b. 如果不存在前串, 则判断当前数据是否已经和已经被 receive_window 的字符串重复。如果存在部分重复则截断，存在全部重复则直接丢弃。
-//   2. 获取当前 index 在 receive_window 中的后串。 如果存在后串
-//     a. 如果后串 没有被当前数据完全包含，则判断是否存在重复区域。如果存在则截断。
-//     b. 如果后串 被当前数据包含，则将后串 从 receive_window 中丢弃，之后重新取出一个新的后串
-//     重复第二步 这时候我们可以获得与 receive_window 中没有任何重复的字符串
-//     我们没有将不同的串合并，只是让串之间不能重叠即可
-    //  我们没有将不同的串合并，只是保证了不能重叠。合并省去了，感觉可能影响效率。
-    //  寻找 新串index 的 前串(其idx <= index)
-    map<size_t,string>::iterator prev_iter = _receving_window.upper_bound(index);       //  >
-    if(prev_iter!=_receving_window.begin())         //  <=
-        --prev_iter;
-    //  1. prev_iter == begin_iter == end_iter，表示_receive_window不存在任何数据
-    //  2. prev_iter != end_iter. prev_iter 指向前串 prev_iter指向后串
-    //  new_idx 至少要从 first_unassembled()开始
-    size_t new_idx = max(index,first_unassembled());
-    //  _receving_window.empty()
-    if(prev_iter == _receving_window.end())
-    {
-        //  _receving_window.empty()
+//  原先的实现 (map<size_t,string>) 只保证了串之间不重叠, 并不合并; 每次去除重叠部分都要substr拷贝一次.
+//  乱序严重时map里会有成千上万个小串.
+//  现在:
+//   1. 先把data裁剪到窗口 [first_unassembled(), first_unacceptable()) 之内 (只移动Buffer的偏移量, 不拷贝)
+//   2. 找到与之重叠或相邻的所有run, 连同data中填补它们之间空隙的slice, 合并成一个run
+//   3. 如果窗口最左边的run从first_unassembled()开始, 就把它写入_output
+//  由于相邻的run总会被合并, map中run的个数就是空洞的个数, 查找/插入都是 O(log 空洞数)
+void StreamReassembler::push_substring(const Buffer &data, const uint64_t index, const bool eof) {
+    if (eof) {
+        _eof = true;
+        _eof_idx = index + data.size();
     }
-    //  如果是 前串(其idx < index) 
-    else if(prev_iter->first <= index)
-    {
-        new_idx = max(prev_iter->first + prev_iter->second.size(),index);
+
+    const size_t start = max(index, first_unassembled());
+    const size_t end = min(index + data.size(), first_unacceptable());
+    if (start < end) {
+        Buffer clipped{data};
+        clipped.remove_prefix(start - index);
+        clipped.remove_suffix(clipped.size() - (end - start));
+        insert_run(start, clipped);
+        assemble();
     }
-    
-    //  在考虑new data前面可能有老串重叠的情况下，得出data非重叠部分的起始偏移量(相对)
-    size_t data_start_offset = new_idx - index;
-    //  去除重叠部分的data长度
-        //  出去重叠前缀的data长度
-    if(data.size() < (new_idx - index))    //  如果已经全部都在bytestream中     不写是因为可能有空的eof
-        return ;
-    if(data.size() == new_idx - index)
-    {
-        if(eof)
-        {
-            _eof = true;
-            _eof_idx = index + data.size();
-            // cout<<"EOF IDX "<<_eof_idx<<endl;
-        }
-        if(_eof && _eof_idx <= first_unassembled())
-        {
-            _output.end_input();
-        }
+
+    if (_eof && _eof_idx <= first_unassembled()) {
+        _output.end_input();
     }
-    size_t data_size = data.size() - (new_idx - index);
-    
-
-    // cout<<"new_idx "<<new_idx<<"data_size "<<data_size<<" "<<data_start_offset<<endl;
-
-    //  寻找后串(且idx >= new_idx) :去掉全部覆盖的以及重叠后缀
-    map<size_t,string>::iterator ne_iter = _receving_window.lower_bound(new_idx);           // >=    
-    //  如果和后面的重叠
-    while(ne_iter!=_receving_window.end() && new_idx <= ne_iter->first && new_idx + data_size > ne_iter->first)
-    {
-        //  new data 全部覆盖 ne_iter
-        if(new_idx + data_size >= ne_iter->first + ne_iter->second.size())
-        {
-            _receiving_window_size -= ne_iter->second.size();
-            ne_iter = _receving_window.erase(ne_iter);
-        }
-        //  new data 部分覆盖 ne_iter，去除后缀
-        else
-        {
-                //  去除后缀的data长度
-            data_size = ne_iter->first - new_idx;
+}
+
+//  不重建BufferList: 把重叠/相邻的run中slice最多的那个(称为基串)的BufferList从map中移出,
+//  其余部分 (data中填补空隙的slice, 以及较小的run) 按顺序接到它前面或后面.
+//  一个slice只有在它所在的run较小时才会被搬动, 所以每个slice最多被搬动 O(log 片段数) 次;
+//  逆序到达时基串就是后串, 每次只在它前面插入一个slice.
+void StreamReassembler::insert_run(const size_t index, const Buffer &data) {
+    const size_t end = index + data.size();
+    //  data中 [from, to) 这一段的slice
+    const auto slice = [&](const size_t from, const size_t to) {
+        Buffer ret{data};
+        ret.remove_prefix(from - index);
+        ret.remove_suffix(end - to);
+        return ret;
+    };
+
+    //  前串 : 起始下标 < index 的最后一个run. 只有与data重叠或相邻时才需要合并
+    auto first = _receving_window.upper_bound(index);
+    if (first != _receving_window.begin() && prev(first)->second.end >= index) {
+        --first;
+    }
+    //  [first, last) 是与data重叠或相邻的所有run. 相邻的run之间总有空洞, 空洞都在data之内
+    auto last = first;
+    auto base = first;
+    while (last != _receving_window.end() && last->first <= end) {
+        if (last->second.data.buffers().size() > base->second.data.buffers().size()) {
+            base = last;
         }
+        ++last;
+    }
+    if (first == last) {
+        _receving_window.emplace(index, Run{end, BufferList(data)});
+        _receiving_window_size += data.size();
+        return;
+    }
+
+    Run merged = std::move(base->second);
+    //  基串之前: 从右往左, 依次把空洞的slice和前面的run接到merged前面
+    size_t left = base->first;
+    for (auto iter = base; iter != first;) {
+        --iter;
+        merged.data.prepend(slice(iter->second.end, left));
+        _receiving_window_size += left - iter->second.end;
+        merged.data.prepend(iter->second.data);
+        left = iter->first;
+    }
+    if (index < left) {
+        merged.data.prepend(slice(index, left));
+        _receiving_window_size += left - index;
+        left = index;
+    }
+    //  基串之后: 从左往右接到merged后面
+    for (auto iter = next(base); iter != last; ++iter) {
+        merged.data.append(slice(merged.end, iter->first));
+        _receiving_window_size += iter->first - merged.end;
+        merged.data.append(iter->second.data);
+        merged.end = iter->second.end;
+    }
+    if (merged.end < end) {
+        merged.data.append(slice(merged.end, end));
+        _receiving_window_size += end - merged.end;
+        merged.end = end;
     }
 
-    //  至此，我们得到的 data.substr(data_start_offset,data_size) 
-    //  是一个不和receive_window中其他字段重叠的data
-    // 检测是否存在数据超出了窗口容量
-    if (first_unacceptable() <= new_idx)
+    _receving_window.erase(first, last);
+    _receving_window.emplace(left, std::move(merged));
+}
+
+void StreamReassembler::assemble() {
+    auto iter = _receving_window.begin();
+    if (iter == _receving_window.end() || iter->first != first_unassembled()) {
         return;
-    
-    // cout<<"start offset "<<data_start_offset<<" data_size "<<data_size<<endl;
-    if(data_size > 0)
-    {
-        string isolated_data = data.substr(data_start_offset,data_size);
-        // cout<<"isolated data "<<isolated_data<<endl;
-        //  新串未构成顺序，不可直接写入stream
-        if(first_unassembled() < new_idx)
-        {
-            _receiving_window_size += isolated_data.size();
-            _receving_window.insert({new_idx,std::move(isolated_data)});
-        }
-        //  新串和stream构成顺序，可以直接写入stream
-        else if(first_unassembled() == new_idx)
-        {
-            // cout<<"try to write "<<isolated_data<<endl;
-            size_t written = _output.write(isolated_data);
-            //  没写完 -> 将剩下的str存入receive_window  维护_receive_window_size
-            if(written < data_size)
-            {
-                string left_data = isolated_data.substr(written,data_size - written);
-                _receiving_window_size += left_data.size();
-                _receving_window.insert({new_idx + written , left_data});
-            }
-        }
-        else
-        {
-            cerr<<"never reach!"<<endl;
-        }
     }
 
-    //  本次来的新串写入bytestream之后 , 有可能造成别的串也可以压入bytestream了。
-    for(auto iter = _receving_window.begin();iter!=_receving_window.end();)
-    {
-        assert(first_unassembled() <= iter->first);
-        auto idx = iter->first;
-        auto &str = iter->second;
-        //  已经不可写入, break即可
-        if(first_unassembled() != idx)
+    const size_t run_start = iter->first;
+    Run run = std::move(iter->second);
+    _receving_window.erase(iter);
+
+    size_t written = 0;
+    for (const auto &buf : run.data.buffers()) {
+        const size_t n = _output.write(buf);
+        written += n;
+        if (n < buf.size()) {
             break;
-        if(idx == first_unassembled())
-        {
-            // cout<<"try to write "<<str<<endl;
-            size_t written = _output.write(str);
-            //  维护 receive_window_size
-            _receiving_window_size -= written;
-            //  全部写入
-            if(written == str.size())
-            {
-                iter = _receving_window.erase(iter);
-            }
-            //  没全部写入 剩下的重新存入 break;
-            else
-            {
-                int nidx = idx + written;
-                _receving_window.insert({nidx,std::move(str.substr(written))}); 
-                iter = _receving_window.erase(iter);
-                break;
-            }
         }
     }
-    if(eof)
-    {
-        _eof = true;
-        _eof_idx = index + data.size();
-    }
-    if(_eof && _eof_idx <= first_unassembled())
-    {
-        _output.end_input();
-    }
+    _receiving_window_size -= written;
 
+    //  没全部写入(窗口保证了不会发生, 以防万一) 剩下的重新存入
+    if (run_start + written < run.end) {
+        run.data.remove_prefix(written);
+        _receving_window.emplace(run_start + written, std::move(run));
+    }
 }
 
 size_t StreamReassembler::unassembled_bytes() const { 
     return _receiving_window_size;
 }
 
+//  每个run就是一段连续的已缓存字节, run之间即为空洞
+vector<pair<uint64_t, uint64_t>> StreamReassembler::unassembled_ranges() const {
+    vector<pair<uint64_t, uint64_t>> ranges;
+    ranges.reserve(_receving_window.size());
+    for (const auto &[begin, run] : _receving_window) {
+        ranges.emplace_back(begin, run.end);
+    }
+    return ranges;
+}
+
 bool StreamReassembler::empty() const { 
     return unassembled_bytes() == 0 && _output.buffer_empty(); 
 }
@@ -200,6 +183,6 @@ bool StreamReassembler::empty() const {
 // cout<<"show window start"<<endl;
 // for(auto &item : _receving_window)
 // {
-//     cout<<item.first<<" "<<item.second<<endl;
+//     cout<<item.first<<" "<<item.second.end<<" "<<item.second.data.concatenate()<<endl;
 // }
 // cout<<"show window end"<<endl;
\ No newline at end of file
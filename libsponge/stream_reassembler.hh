@@ -8,6 +8,8 @@
 #include <unordered_map>
 #include<memory>
 #include <map>
+#include <utility>
+#include <vector>
 
 using std::unordered_map;
 using std::map;
@@ -24,15 +26,31 @@ class StreamReassembler {
     ByteStream _output;  //!< The reassembled in-order byte stream  有序的bytes
     size_t _capacity;    //!< The maximum number of bytes   
     
+    //! \brief A contiguous run of unassembled bytes
+    //! \details Made of Buffer slices of the segments that carried the bytes, so nothing is copied
+    //! until the run reaches the output stream.
+    struct Run {
+        size_t end;       //!< index one past the last byte of the run
+        BufferList data;  //!< the bytes [key, end)
+    };
+
     // unordered_map<size_t , char> _receving_window;      //  乱序到达的，还没加入bytestream的bytes
-    map<size_t , string> _receving_window;      //  起始下标为key的string
-    //  为支持二分查找. 找到新来串的上一个分组（称为前串）和下一个分组（称为后串）
+    // map<size_t , string> _receving_window;      //  起始下标为key的string
+    //  起始下标为key的run. 相邻或重叠的片段会合并成同一个run, 故map中的元素个数 == 空洞个数 , 而非片段个数
+    //  为支持二分查找. 找到新来串的上一个run（称为前串）和与之重叠/相邻的后续run（称为后串）
+    map<size_t , Run> _receving_window;
 
     size_t first_unacceptable() const {return _output.bytes_read() + _capacity;} // 第一个不可接收的字节，即第一个超出接收范围的字节。receiving_window右边界
     size_t _eof_idx{0};
     bool _eof;
     //  receive_window中字节个数
     size_t _receiving_window_size{0};
+
+    //! Merge the window-clipped slice `data` (starting at `index`) with any runs it overlaps or touches
+    void insert_run(const size_t index, const Buffer &data);
+
+    //! Write the run starting at first_unassembled() (if any) into the output stream
+    void assemble();
   public:
     //! \brief Construct a `StreamReassembler` that will store up to `capacity` bytes.
     //! \note This capacity limits both the bytes that have been reassembled,
@@ -49,6 +67,11 @@ class StreamReassembler {
     //! \param eof the last byte of `data` will be the last byte in the entire stream
     void push_substring(const std::string &data, const uint64_t index, const bool eof);
 
+    //! \brief Receive a substring held in a Buffer (e.g. a segment's payload) without copying it.
+    //! \details Same as push_substring(const std::string &, ...), but the reassembler keeps slices of
+    //! `data` instead of copies.
+    void push_substring(const Buffer &data, const uint64_t index, const bool eof);
+
     //! \name Access the reassembled byte stream
     //!@{
     const ByteStream &stream_out() const { return _output; }
@@ -61,6 +84,10 @@ class StreamReassembler {
     //! should only be counted once for the purpose of this function.
     size_t unassembled_bytes() const;
 
+    //! \brief The stored but not yet reassembled bytes, as [begin, end) stream indices in increasing order
+    //! \details Used by the TCPReceiver to report SACK blocks.
+    std::vector<std::pair<uint64_t, uint64_t>> unassembled_ranges() const;
+
     //! \brief Is the internal state empty (other than the output stream)?
     //! \returns `true` if no substrings are waiting to be assembled
     bool empty() const;
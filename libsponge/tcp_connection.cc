@@ -56,8 +56,17 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
         ack_to_send = true;
     }
 
+    if (seg.header().syn) {
+        _peer_sack_permitted = seg.header().options.sack_permitted;
+        _peer_window_scale = seg.header().options.window_scale;
+        if (seg.header().options.mss.has_value()) {
+            _sender.set_peer_mss(*seg.header().options.mss);
+        }
+    }
+
     //  _receiver.segment_received is robust enough to deal with invalid seg
     //  receiver care about seqno, syn , payload, and fin .
+    const optional<WrappingInt32> ackno_before = _receiver.ackno();
     _receiver.segment_received(seg);
 
     //  if the incoming segment occupied any sequence numbers, the TCPConnection makes sure that at least one segment is
@@ -65,11 +74,21 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
     if (seg.length_in_sequence_space() > 0)  //  receiver recv syn , payload , fin
         ack_to_send = true;                  //  send empty segment with ack if can not shaodai
 
+    //  delayed ack: 按序到达且没有填补空洞的数据段, 每两个才ack一次 (或等ack_delay超时).
+    //  乱序/填洞的段要立即ack, peer的快速重传靠这些dup ack (RFC 5681 4.2)
+    const bool in_order = ackno_before.has_value() && !seg.header().syn && !seg.header().fin &&
+                          seg.payload().size() > 0 && _receiver.unassembled_bytes() == 0 &&
+                          _receiver.ackno() == ackno_before.value() + seg.payload().size();
+    const bool delay_ack = _cfg.delayed_ack && in_order && ++_delayed_ack_segments < 2;
+
     //  if the ack flag is set, tells the TCPSender about the fields it cares about on incoming segments: ackno and
     //  window size. if TCPsender is CLOSED , then any ack is invalid, because that ack reflect the connection that
     //  local Sender发起. However , if local Sender is still CLOSED when ack received , it's illegal
     if (seg.header().ack && _sender.state() != TCPSender::State::CLOSED) {
-        _sender.ack_received(seg.header().ackno, seg.header().win);
+        //  RFC 7323 (2.2): SYN中的窗口不缩放
+        const size_t window = seg.header().syn || !window_scaling() ? seg.header().win
+                                                                    : size_t{seg.header().win} << *_peer_window_scale;
+        _sender.ack_received(seg.header().ackno, window, seg.length_in_sequence_space() > 0, seg.header().options.sack);
         _sender.fill_window();  //  有可能ack_received中没fill到
     }
 
@@ -97,8 +116,12 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
     //     _linger_after_streams_finish) {}
 
     //  if we need to send ack but it can't be 捎带
-    if (ack_to_send && _sender.segments_out().empty())
-        _sender.send_empty_segment();
+    if (ack_to_send && _sender.segments_out().empty()) {
+        if (delay_ack)
+            ++_acks_suppressed;  //  等下一个段或tick中的定时器再ack
+        else
+            _sender.send_empty_segment();
+    }
 
     send_segments();
 }
@@ -108,7 +131,15 @@ bool TCPConnection::active() const { return _active; }
 //  upper user use the write() function to send the data from application layer
 size_t TCPConnection::write(const string &data) {
     //  write into sender's outbound_stream
-    size_t bytes_written = _sender.stream_in().write(data);
+    return after_write(_sender.stream_in().write(data));
+}
+
+//  data 的storage 直接交给 outbound_stream, 不必拷贝
+size_t TCPConnection::write(string &&data) { return after_write(_sender.stream_in().write(move(data))); }
+
+size_t TCPConnection::write(Buffer data) { return after_write(_sender.stream_in().write(move(data))); }
+
+size_t TCPConnection::after_write(const size_t bytes_written) {
     //  send it over TCP if possible
     _sender.fill_window();
     send_segments();
@@ -133,6 +164,13 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
         return;
     }
 
+    //  delayed ack 超时: 把攒着的ack发出去
+    if (_delayed_ack_segments > 0) {
+        _delayed_ack_timer += ms_since_last_tick;
+        if (_delayed_ack_timer >= _cfg.ack_delay && _sender.segments_out().empty())
+            _sender.send_empty_segment();
+    }
+
     //  因为tick可能会造成sender重传 故tcpconnection需要及时将segment从sender中取出发送
     send_segments();
 
@@ -146,6 +184,27 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
     }
 }
 
+//  tick()里每个定时动作还要等多久; 取最早的一个
+optional<size_t> TCPConnection::next_timeout() const {
+    if (!_active) {
+        return nullopt;
+    }
+    optional<size_t> next = _sender.next_timeout();
+    const auto earliest = [&next](const size_t elapsed, const size_t limit) {
+        const size_t remaining = elapsed >= limit ? 0 : limit - elapsed;
+        next = next.has_value() ? min(*next, remaining) : remaining;
+    };
+    if (_delayed_ack_segments > 0) {
+        earliest(_delayed_ack_timer, _cfg.ack_delay);
+    }
+    //  TIME_WAIT
+    if (_receiver.state() == TCPReceiver::State::FIN_RECV && _sender.state() == TCPSender::State::FIN_ACKED &&
+        _linger_after_streams_finish) {
+        earliest(_time_since_last_segment_received, 10 * _cfg.rt_timeout);
+    }
+    return next;
+}
+
 //  shutdown TCPSender's outbound_stream
 void TCPConnection::end_input_stream() {
     _sender.stream_in().end_input();
@@ -154,12 +213,27 @@ void TCPConnection::end_input_stream() {
     send_segments();
 }
 
+void TCPConnection::set_nodelay(const bool nodelay) {
+    _sender.set_nagle(!nodelay);
+    //  还没有连接时不能fill_window, 那会发出SYN
+    if (nodelay && _sender.next_seqno_absolute() > 0) {
+        _sender.fill_window();
+        send_segments();
+    }
+}
+
 void TCPConnection::connect() {
     //  send syn . TCPSender : CLOSED -> SYN_SENT
     _sender.fill_window();
     send_segments();
 }
 
+void TCPConnection::abort() {
+    if (active()) {
+        unclean_shutdown(true);
+    }
+}
+
 TCPConnection::~TCPConnection() {
     try {
         if (active()) {
@@ -185,9 +259,27 @@ void TCPConnection::send_segments() {
             seg.header().ack = true;
             seg.header().ackno = ackno.value();
             seg.header().win = _receiver.window_size();
+            //  这个ack覆盖了所有被delay的段
+            _delayed_ack_segments = 0;
+            _delayed_ack_timer = 0;
+        }
+        //  捎带window_size. 窗口缩放生效后, 除SYN外通告的都是 window >> shift
+        const size_t window = seg.header().syn || !window_scaling() ? _receiver.window_size()
+                                                                    : _receiver.window_size() >> _cfg.window_shift();
+        seg.header().win = min(window, static_cast<size_t>(std::numeric_limits<uint16_t>::max()));
+        //  SYN/ACK只能回应peer的SYN中出现过的选项 (RFC 2018 (2), RFC 7323 (2.2))
+        if (seg.header().syn && seg.header().ack) {
+            seg.header().options.sack_permitted = seg.header().options.sack_permitted && _peer_sack_permitted;
+            if (!_peer_window_scale) {
+                seg.header().options.window_scale.reset();
+            }
+            seg.header().update_doff();
+        }
+        //  双方都在SYN中允许了SACK : 用SACK block告诉peer乱序到达的数据
+        if (ackno.has_value() && _cfg.sack && _peer_sack_permitted) {
+            seg.header().options.sack = _receiver.sack_blocks(seg.header().options.sack_room());
+            seg.header().update_doff();
         }
-        //  捎带window_size
-        seg.header().win = min(_receiver.window_size(), static_cast<size_t>(std::numeric_limits<uint16_t>::max()));
         //  会出现多个segment捎带同一ack.不过应该不影响正确性. ack已经ack过的报文，在receiver看来就是直接忽略即可
         _segments_out.push(seg);
     }
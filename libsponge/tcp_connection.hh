@@ -13,7 +13,7 @@ class TCPConnection {
   private:
     TCPConfig _cfg;
     TCPReceiver _receiver{_cfg.recv_capacity};
-    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
+    TCPSender _sender{_cfg};
 
     //! outbound queue of segments that the TCPConnection wants sent
     std::queue<TCPSegment> _segments_out{};
@@ -24,8 +24,17 @@ class TCPConnection {
     bool _linger_after_streams_finish{true};    //  本端是否需要等待linger time 来满足 #4
     bool _active{true};
     size_t _time_since_last_segment_received{0};
+    bool _peer_sack_permitted{false};  //!< the peer's SYN carried SACK-permitted
+    std::optional<uint8_t> _peer_window_scale{};  //!< window scale shift from the peer's SYN
+    size_t _delayed_ack_segments{0};  //!< in-order data segments received since the last ACK was sent
+    size_t _delayed_ack_timer{0};     //!< milliseconds since the oldest of those segments arrived
+    uint64_t _acks_suppressed{0};     //!< ACKs held back by delayed_ack and folded into a later one
+
+    //! Both SYNs carried the window scale option, so windows (other than on SYNs) are scaled
+    bool window_scaling() const { return _cfg.window_scaling && _peer_window_scale.has_value(); }
   private:
     void send_segments();
+    size_t after_write(const size_t bytes_written);
     void unclean_shutdown(bool rst_to_send = false);
     void clean_shutdown();
   public:
@@ -39,11 +48,22 @@ class TCPConnection {
     //! \returns the number of bytes from `data` that were actually written.
     size_t write(const std::string &data);
 
+    //! \brief Write data to the outbound byte stream, taking ownership of its storage
+    //! \returns the number of bytes from `data` that were actually written.
+    size_t write(std::string &&data);
+
+    //! \brief Write a Buffer to the outbound byte stream, sharing its storage
+    //! \returns the number of bytes from `data` that were actually written.
+    size_t write(Buffer data);
+
     //! \returns the number of `bytes` that can be written right now.
     size_t remaining_outbound_capacity() const;
 
     //! \brief Shut down the outbound byte stream (still allows reading incoming data)
     void end_input_stream();
+
+    //! \brief Turn Nagle's algorithm off (like TCP_NODELAY) or back on, sending whatever it was holding back
+    void set_nodelay(const bool nodelay);
     //!@}
 
     //! \name "Output" interface for the reader
@@ -62,6 +82,12 @@ class TCPConnection {
     size_t unassembled_bytes() const;
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
+    //! \brief smoothed round-trip time in milliseconds (see TCPSender::srtt())
+    uint64_t srtt() const { return _sender.srtt(); }
+    //! \brief current retransmission timeout in milliseconds (see TCPSender::rto())
+    uint64_t rto() const { return _sender.rto(); }
+    //! \brief number of ACKs that delayed ACK folded into a later segment instead of sending
+    uint64_t acks_suppressed() const { return _acks_suppressed; }
     //!< \brief summarize the state of the sender, receiver, and the connection
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
     //!@}
@@ -75,6 +101,13 @@ class TCPConnection {
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
+    //! \brief Milliseconds until tick() next has something to do (retransmission, delayed ACK, end of
+    //! TIME_WAIT), or empty if nothing is pending; tick() need not be called any sooner
+    std::optional<size_t> next_timeout() const;
+
+    //! \brief Abort the connection at once, queueing a RST for the peer if it is still active
+    void abort();
+
     //! \brief TCPSegments that the TCPConnection has enqueued for transmission.
     //! \note The owner or operating system will dequeue these and
     //! put each one into the payload of a lower-layer datagram (usually Internet datagrams (IP),
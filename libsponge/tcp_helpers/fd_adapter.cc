@@ -1,6 +1,11 @@
 #include "fd_adapter.hh"
 
+#include "util.hh"
+
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <utility>
 
@@ -22,23 +27,40 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
 
     // cerr<<"TCPOverUDPSocketAdapter::read"<<endl;
 
-    auto datagram = _sock.recv();
+    //  GRO合并的datagram里上次没返回完的segment
+    if (not _pending.empty()) {
+        TCPSegment seg = move(_pending.front());
+        _pending.pop_front();
+        return seg;
+    }
+
+    probe_offload();
+    vector<TCPSegment> segs;
+    accept(_sock.recv(), segs);
+    if (segs.empty()) {
+        return {};
+    }
+    _pending.insert(_pending.end(), make_move_iterator(segs.begin() + 1), make_move_iterator(segs.end()));
+    return move(segs.front());
+}
 
+//! \details The checks of read(), applied to one UDP payload
+optional<TCPSegment> TCPOverUDPSocketAdapter::accept(const Address &source, Buffer payload) {
     // is it for us?
-    if (not listening() and (datagram.source_address != config().destination)) {
+    if (not listening() and (source != config().destination)) {
         return {};
     }
     //  应对 tcp_in_udp_in_ip
     // is the payload a valid TCP segment?
     TCPSegment seg;
-    if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+    if (ParseResult::NoError != seg.parse(move(payload), 0)) {
         return {};
     }
 
     // should we target this source in all future replies?
     if (listening()) {
         if (seg.header().syn and not seg.header().rst) {
-            config_mutable().destination = datagram.source_address;
+            config_mutable().destination = source;
             set_listening(false);
         } else {
             return {};
@@ -48,6 +70,40 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
     return seg;
 }
 
+//! \details A datagram coalesced by GRO is split back into its original payloads. They share its storage, so
+//! nothing is copied.
+void TCPOverUDPSocketAdapter::accept(UDPSocket::received_datagram &&datagram, vector<TCPSegment> &segs) {
+    const size_t step = datagram.segment_size;
+    if (step == 0 or datagram.payload.size() <= step) {
+        if (auto seg = accept(datagram.source_address, move(datagram.payload))) {
+            segs.push_back(move(seg.value()));
+        }
+        return;
+    }
+
+    const Buffer whole{move(datagram.payload)};
+    for (size_t offset = 0; offset < whole.size(); offset += step) {
+        Buffer payload{whole};
+        payload.remove_prefix(offset);
+        payload.remove_suffix(payload.size() - min(step, payload.size()));
+        if (auto seg = accept(datagram.source_address, move(payload))) {
+            segs.push_back(move(seg.value()));
+        }
+    }
+}
+
+//! \details GRO is turned on if the kernel has it; GSO is used for sending if the kernel has it (and turned
+//! back off by write_batch() if the route can't do it). Without either, the adapter falls back to one datagram
+//! per segment.
+void TCPOverUDPSocketAdapter::probe_offload() {
+    if (_offload_probed or not config().udp_offload) {
+        return;
+    }
+    _offload_probed = true;
+    _sock.set_gro();
+    _gso = _sock.gso_supported();
+}
+
 //! Serialize a TCP segment and send it as the payload of a UDP datagram.
 //! \param[in] seg is the TCP segment to write
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
@@ -57,5 +113,97 @@ void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     _sock.sendto(config().destination, seg.serialize(0));
 }
 
+//! \details Like read(), but drains as many as FdAdapterConfig::max_batch datagrams from the socket with one
+//! recvmmsg(), so that a burst of segments costs one wakeup and one system call.
+vector<TCPSegment> TCPOverUDPSocketAdapter::read_batch() {
+    probe_offload();
+    vector<TCPSegment> segs{make_move_iterator(_pending.begin()), make_move_iterator(_pending.end())};
+    _pending.clear();
+
+    _batch.resize(max<size_t>(config().max_batch, 1), {{nullptr, 0}, ""});
+    const size_t received = _sock.recv_batch(_batch);
+
+    segs.reserve(segs.size() + received);
+    for (size_t i = 0; i < received; ++i) {
+        //  同UDPSocket::recv : 不让payload的Buffer slice占住mtu大小的storage (GRO合并的则几乎占满, 不必再拷贝)
+        if (_batch[i].segment_size == 0) {
+            _batch[i].payload.shrink_to_fit();
+        }
+        accept(move(_batch[i]), segs);
+    }
+    return segs;
+}
+
+void TCPOverUDPSocketAdapter::flush(vector<BufferViewList> &payloads) {
+    if (not payloads.empty()) {
+        _sock.sendto_batch(config().destination, payloads);
+        payloads.clear();
+    }
+}
+
+//! \details Serializes the queued segments and hands them to sendmmsg() in groups of FdAdapterConfig::max_batch.
+//! With GSO, each run of equal-sized segments (a full window of MSS-sized ones, typically) instead goes to the
+//! kernel as one buffer in one UDP_SEGMENT send. A run may end with one shorter segment.
+//! \param[in,out] segs is the queue of TCP segments to write; it is empty on return
+void TCPOverUDPSocketAdapter::write_batch(queue<TCPSegment> &segs) {
+    probe_offload();
+    const size_t batch = max<size_t>(config().max_batch, 1);
+
+    vector<BufferList> serialized;
+    serialized.reserve(segs.size());
+    while (not segs.empty()) {
+        TCPSegment &seg = segs.front();
+        seg.header().sport = config().source.port();
+        seg.header().dport = config().destination.port();
+        serialized.push_back(seg.serialize(0));
+        segs.pop();
+    }
+
+    vector<BufferViewList> payloads;
+    for (size_t i = 0; i < serialized.size();) {
+        const size_t size = serialized[i].size();
+        size_t end = i + 1, bytes = size;
+        while (_gso and end < serialized.size() and end - i < UDPSocket::MAX_GSO_SEGMENTS and
+               serialized[end].size() <= size and bytes + serialized[end].size() <= UDPSocket::MAX_GSO_BYTES) {
+            bytes += serialized[end].size();
+            if (serialized[end++].size() < size) {
+                break;
+            }
+        }
+
+        if (end - i == 1) {
+            payloads.emplace_back(serialized[i]);
+            if (payloads.size() == batch) {
+                flush(payloads);
+            }
+            i = end;
+            continue;
+        }
+
+        flush(payloads);
+        BufferViewList run;
+        for (size_t k = i; k < end; ++k) {
+            for (const auto &buffer : serialized[k].buffers()) {
+                run.append(buffer);
+            }
+        }
+        try {
+            _sock.sendto_segmented(config().destination, run, size);
+        } catch (const unix_error &e) {
+            //  EIO : 出口设备不能做checksum offload, 这条路由上用不了GSO. 退回逐个发送这一段
+            if (e.code().value() != EIO) {
+                throw;
+            }
+            _gso = false;
+            for (size_t k = i; k < end; ++k) {
+                payloads.emplace_back(serialized[k]);
+            }
+            flush(payloads);
+        }
+        i = end;
+    }
+    flush(payloads);
+}
+
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
 template class LossyFdAdapter<TCPOverUDPSocketAdapter>;
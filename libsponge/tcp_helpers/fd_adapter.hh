@@ -8,8 +8,11 @@
 #include "tcp_header.hh"
 #include "tcp_segment.hh"
 
+#include <deque>
 #include <optional>
+#include <queue>
 #include <utility>
+#include <vector>
 
 //! \brief Basic functionality for file descriptor adaptors
 //! \details See TCPOverUDPSocketAdapter and TCPOverIPv4OverTunFdAdapter for more information.
@@ -40,6 +43,9 @@ class FdAdapterBase {
 
     //! Called periodically when time elapses
     void tick(const size_t) {}
+
+    //! Milliseconds until tick() has something to do: never, for an adapter without timers
+    std::optional<size_t> next_timeout() const { return std::nullopt; }
 };
 
 //! \brief A FD adaptor that reads and writes TCP segments in UDP payloads
@@ -47,6 +53,28 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
   private:
     UDPSocket _sock;
 
+    //! receive buffers for read_batch(), kept between calls
+    std::vector<UDPSocket::received_datagram> _batch{};
+
+    //! \name UDP segmentation offload, only used when FdAdapterConfig::udp_offload is set
+    //!@{
+    bool _offload_probed{false};        //!< has the socket been set up for GSO/GRO yet?
+    bool _gso{false};                   //!< send runs of equal-sized segments with one UDP_SEGMENT send
+    std::deque<TCPSegment> _pending{};  //!< segments from a GRO datagram that read() has not returned yet
+    //!@}
+
+    //! Turn on GRO and check for GSO, once, if FdAdapterConfig::udp_offload asks for them
+    void probe_offload();
+
+    //! Parse a TCP segment from a payload if it belongs to the current connection
+    std::optional<TCPSegment> accept(const Address &source, Buffer payload);
+
+    //! Append the TCP segments in a datagram (several, if GRO coalesced them) that belong to the current connection
+    void accept(UDPSocket::received_datagram &&datagram, std::vector<TCPSegment> &segs);
+
+    //! Send the payloads as one datagram each, with one sendmmsg(), and clear them
+    void flush(std::vector<BufferViewList> &payloads);
+
   public:
     //! Construct from a UDPSocket sliced into a FileDescriptor
     explicit TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(std::move(sock)) {}
@@ -57,6 +85,13 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
     //! Writes a TCP segment into a UDP payload
     void write(TCPSegment &seg);
 
+    //! Reads up to FdAdapterConfig::max_batch UDP payloads with one system call, returning the TCP segments among
+    //! them that are related to the current connection
+    std::vector<TCPSegment> read_batch();
+
+    //! Writes every segment in `segs` (leaving it empty), up to FdAdapterConfig::max_batch per system call
+    void write_batch(std::queue<TCPSegment> &segs);
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
@@ -6,9 +6,12 @@
 #include "tcp_segment.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <optional>
+#include <queue>
 #include <random>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template <typename AdapterT>
@@ -56,6 +59,27 @@ class LossyFdAdapter {
         return _adapter.write(seg);
     }
 
+    //! \brief Read a batch from the underlying AdapterT instance, dropping each segment with the downlink loss rate
+    std::vector<TCPSegment> read_batch() {
+        auto segs = _adapter.read_batch();
+        segs.erase(std::remove_if(segs.begin(), segs.end(), [&](const TCPSegment &) { return _should_drop(false); }),
+                   segs.end());
+        return segs;
+    }
+
+    //! \brief Write a batch to the underlying AdapterT instance, dropping each segment with the uplink loss rate
+    //! \param[in,out] segs is the queue of segments to write or drop; it is empty on return
+    void write_batch(std::queue<TCPSegment> &segs) {
+        std::queue<TCPSegment> kept;
+        while (not segs.empty()) {
+            if (not _should_drop(true)) {
+                kept.push(std::move(segs.front()));
+            }
+            segs.pop();
+        }
+        _adapter.write_batch(kept);
+    }
+
     //! \name
     //! Passthrough functions to the underlying AdapterT instance
 
@@ -66,6 +90,9 @@ class LossyFdAdapter {
     void tick(const size_t ms_since_last_tick) {
         _adapter.tick(ms_since_last_tick);
     }  //!< FdAdapterBase::tick passthrough
+    std::optional<size_t> next_timeout() const {
+        return _adapter.next_timeout();
+    }  //!< FdAdapterBase::next_timeout passthrough
     //!@}
 };
 
@@ -2,24 +2,57 @@
 #define SPONGE_LIBSPONGE_TCP_CONFIG_HH
 
 #include "address.hh"
+#include "eventloop.hh"
+#include "tcp_header.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
 #include <cstdint>
 #include <optional>
 
+//! Congestion control algorithm of a TCPSender (see CongestionControl)
+enum class CongestionControlAlgorithm {
+    None,  //!< Only the receiver's window limits the sender
+    Reno,  //!< RenoCongestionControl
+    Cubic  //!< CubicCongestionControl
+};
+
 //! Config for TCP sender and receiver
 class TCPConfig {
   public:
     static constexpr size_t DEFAULT_CAPACITY = 64000;  //!< Default capacity
-    static constexpr size_t MAX_PAYLOAD_SIZE = 1000;   //!< Conservative max payload size for real Internet
+    static constexpr size_t MAX_PAYLOAD_SIZE = 1000;   //!< Conservative max payload size for real Internet (default mss)
+    static constexpr uint16_t MIN_MSS = 48;            //!< Smallest MSS option from a peer that is honored
     static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
     static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
+    static constexpr uint16_t TIMEOUT_MIN = 200;       //!< Default lower bound of the adaptive re-transmit timeout
+    static constexpr uint32_t TIMEOUT_MAX = 60000;     //!< Default upper bound of the adaptive re-transmit timeout
+    static constexpr uint16_t ACK_DELAY_DFLT = 40;     //!< Default delayed-ACK timeout, in milliseconds
 
     uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds
+    bool rtt_estimation = false;              //!< Adapt the retransmission timeout to measured RTTs (RFC 6298)
+    uint16_t rt_timeout_min = TIMEOUT_MIN;    //!< With rtt_estimation, lower bound of the timeout, in milliseconds
+    uint32_t rt_timeout_max = TIMEOUT_MAX;    //!< With rtt_estimation, upper bound of the timeout, in milliseconds
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
+    uint16_t mss = MAX_PAYLOAD_SIZE;          //!< Largest payload to send or receive; offered in the SYN's MSS option
     std::optional<WrappingInt32> fixed_isn{};
+    CongestionControlAlgorithm congestion_control = CongestionControlAlgorithm::None;  //!< Sender's cwnd policy
+    bool fast_retransmit = false;  //!< Retransmit on the third duplicate ACK, then do fast recovery (RFC 5681, RFC 6582)
+    bool sack = false;  //!< Negotiate SACK (RFC 2018) and repair only the missing ranges in fast recovery; implies fast_retransmit
+    bool window_scaling = false;  //!< Negotiate window scaling (RFC 7323) so that windows above 64 KiB can be advertised
+    bool nagle = false;  //!< Hold back sub-MSS segments while data is unacknowledged (RFC 896); see TCP_NODELAY
+    bool delayed_ack = false;     //!< ACK every second in-order data segment, or after ack_delay (RFC 1122 4.2.3.2)
+    uint16_t ack_delay = ACK_DELAY_DFLT;  //!< With delayed_ack, longest an ACK is held back, in milliseconds
+
+    //! \brief Window scale shift to offer: the smallest one that lets the 16-bit window field cover recv_capacity
+    uint8_t window_shift() const {
+        uint8_t shift = 0;
+        while (shift < TCPOptions::MAX_WINDOW_SCALE && (recv_capacity >> shift) > UINT16_MAX) {
+            ++shift;
+        }
+        return shift;
+    }
 };
 
 //! Config for classes derived from FdAdapter
@@ -30,6 +63,10 @@ class FdAdapterConfig {
 
     uint16_t loss_rate_dn = 0;  //!< Downlink loss rate (for LossyFdAdapter)
     uint16_t loss_rate_up = 0;  //!< Uplink loss rate (for LossyFdAdapter)
+
+    size_t max_batch = 32;  //!< Most datagrams read or written by one system call in read_batch() / write_batch()
+    bool udp_offload = false;  //!< TCPOverUDPSocketAdapter: use UDP GSO and GRO where the kernel supports them
+    EventLoop::Backend event_loop = EventLoop::Backend::Poll;  //!< How TCPSpongeSocket's thread waits for its fds
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_CONFIG_HH
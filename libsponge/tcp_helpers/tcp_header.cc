@@ -1,9 +1,121 @@
 #include "tcp_header.hh"
 
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
+namespace {
+
+//! Option kinds (RFC 793, RFC 2018)
+enum OptionKind : uint8_t { END = 0, NOP = 1, MSS = 2, WINDOW_SCALE = 3, SACK_PERMITTED = 4, SACK = 5 };
+
+constexpr size_t MSS_LENGTH = 4;
+constexpr size_t WINDOW_SCALE_LENGTH = 3;
+constexpr size_t SACK_PERMITTED_LENGTH = 2;
+constexpr size_t SACK_BLOCK_LENGTH = 8;
+
+}  // namespace
+
+//! \param[in,out] p is a NetParser positioned at the first option
+//! \param[in] length is the number of bytes of options, i.e., `4 * doff - TCPHeader::LENGTH`
+//! \details A malformed option ends the option list; the rest of the `length` bytes are skipped.
+void TCPOptions::parse(NetParser &p, size_t length) {
+    *this = {};
+    while (length > 0 && !p.error()) {
+        const uint8_t kind = p.u8();
+        --length;
+        if (kind == END) {
+            break;
+        }
+        if (kind == NOP) {
+            continue;
+        }
+        if (length == 0) {
+            return;
+        }
+        const size_t option_length = p.u8();
+        --length;
+        if (option_length < 2 || option_length - 2 > length) {
+            break;
+        }
+        const size_t body_length = option_length - 2;
+        length -= body_length;
+        if (kind == MSS && body_length == 2) {
+            mss = p.u16();
+        } else if (kind == WINDOW_SCALE && body_length == 1) {
+            //  RFC 7323 (2.3): 超过14的shift按14处理
+            window_scale = min(p.u8(), MAX_WINDOW_SCALE);
+        } else if (kind == SACK_PERMITTED && body_length == 0) {
+            sack_permitted = true;
+        } else if (kind == SACK && body_length % SACK_BLOCK_LENGTH == 0) {
+            sack.clear();
+            for (size_t i = 0; i < body_length / SACK_BLOCK_LENGTH; ++i) {
+                const WrappingInt32 left{p.u32()};
+                const WrappingInt32 right{p.u32()};
+                sack.push_back({left, right});
+            }
+        } else {
+            p.remove_prefix(body_length);
+        }
+    }
+    p.remove_prefix(length);
+}
+
+//! \details Options are laid out the way common stacks do it, with NOPs keeping the SACK blocks 4-byte aligned
+void TCPOptions::serialize(string &s) const {
+    if (mss.has_value()) {
+        NetUnparser::u8(s, MSS);
+        NetUnparser::u8(s, MSS_LENGTH);
+        NetUnparser::u16(s, *mss);
+    }
+    if (window_scale.has_value()) {
+        NetUnparser::u8(s, NOP);
+        NetUnparser::u8(s, WINDOW_SCALE);
+        NetUnparser::u8(s, WINDOW_SCALE_LENGTH);
+        NetUnparser::u8(s, *window_scale);
+    }
+    if (sack_permitted) {
+        NetUnparser::u8(s, NOP);
+        NetUnparser::u8(s, NOP);
+        NetUnparser::u8(s, SACK_PERMITTED);
+        NetUnparser::u8(s, SACK_PERMITTED_LENGTH);
+    }
+    if (!sack.empty()) {
+        if (sack.size() > MAX_SACK_BLOCKS) {
+            throw runtime_error("too many SACK blocks");
+        }
+        NetUnparser::u8(s, NOP);
+        NetUnparser::u8(s, NOP);
+        NetUnparser::u8(s, SACK);
+        NetUnparser::u8(s, 2 + SACK_BLOCK_LENGTH * sack.size());
+        for (const auto &block : sack) {
+            NetUnparser::u32(s, block.left.raw_value());
+            NetUnparser::u32(s, block.right.raw_value());
+        }
+    }
+}
+
+size_t TCPOptions::length() const {
+    string s;
+    serialize(s);
+    return (s.size() + 3) / 4 * 4;
+}
+
+size_t TCPOptions::sack_room() const {
+    TCPOptions others = *this;
+    others.sack.clear();
+    const size_t room = MAX_LENGTH - others.length();
+    //  NOP NOP kind length, 然后是每个block 8字节
+    return room < 4 ? 0 : min(MAX_SACK_BLOCKS, (room - 4) / SACK_BLOCK_LENGTH);
+}
+
+bool TCPOptions::operator==(const TCPOptions &other) const {
+    return mss == other.mss && sack_permitted == other.sack_permitted && sack == other.sack &&
+           window_scale == other.window_scale;
+}
+
 //! \param[in,out] p is a NetParser from which the TCP fields will be extracted
 //! \returns a ParseResult indicating success or the reason for failure
 //! \details It is important to check for (at least) the following potential errors
@@ -37,8 +149,7 @@ ParseResult TCPHeader::parse(NetParser &p) {
         return ParseResult::HeaderTooShort;
     }
 
-    // skip any options or anything extra in the header
-    p.remove_prefix(doff * 4 - TCPHeader::LENGTH);
+    options.parse(p, doff * 4 - TCPHeader::LENGTH);
 
     if (p.error()) {
         return p.get_error();
@@ -73,7 +184,12 @@ string TCPHeader::serialize() const {
 
     NetUnparser::u16(ret, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    options.serialize(ret);  // options
+    if (ret.size() > 4 * doff) {
+        throw runtime_error("TCP options do not fit in doff");
+    }
+
+    ret.resize(4 * doff);  // expand header to advertised size, padding the options with END
 
     return ret;
 }
@@ -90,14 +206,22 @@ string TCPHeader::to_string() const {
        << " fin: " << fin << '\n'
        << "TCP winsize: " << +win << '\n'
        << "TCP cksum: " << +cksum << '\n'
-       << "TCP uptr: " << +uptr << '\n';
+       << "TCP uptr: " << +uptr << '\n'
+       << "TCP options: mss: " << (options.mss.has_value() ? std::to_string(*options.mss) : "none")
+       << " sack_permitted: " << options.sack_permitted << " sack blocks: " << options.sack.size()
+       << " window scale: " << (options.window_scale.has_value() ? std::to_string(*options.window_scale) : "none")
+       << '\n';
     return ss.str();
 }
 
 string TCPHeader::summary() const {
     stringstream ss{};
     ss << "Header(flags=" << (syn ? "S" : "") << (ack ? "A" : "") << (rst ? "R" : "") << (fin ? "F" : "")
-       << ",seqno=" << seqno << ",ack=" << ackno << ",win=" << win << ")";
+       << ",seqno=" << seqno << ",ack=" << ackno << ",win=" << win;
+    for (const auto &block : options.sack) {
+        ss << ",sack=" << block.left << "-" << block.right;
+    }
+    ss << ")";
     return ss.str();
 }
 
@@ -105,5 +229,5 @@ bool TCPHeader::operator==(const TCPHeader &other) const {
     // TODO(aozdemir) more complete check (right now we omit cksum, src, dst
     return seqno == other.seqno && ackno == other.ackno && doff == other.doff && urg == other.urg && ack == other.ack &&
            psh == other.psh && rst == other.rst && syn == other.syn && fin == other.fin && win == other.win &&
-           uptr == other.uptr;
+           uptr == other.uptr && options == other.options;
 }
@@ -4,8 +4,46 @@
 #include "parser.hh"
 #include "wrapping_integers.hh"
 
+#include <optional>
+#include <string>
+#include <vector>
+
+//! \brief A SACK block (RFC 2018): the receiver holds the sequence numbers [left, right)
+struct SACKBlock {
+    WrappingInt32 left{0};   //!< first sequence number of the block
+    WrappingInt32 right{0};  //!< sequence number just past the block
+
+    bool operator==(const SACKBlock &other) const { return left == other.left && right == other.right; }
+};
+
+//! \brief The TCP options this implementation understands; any others are skipped when parsing
+struct TCPOptions {
+    static constexpr size_t MAX_LENGTH = 40;         //!< Room for options in a header with doff = 15
+    static constexpr size_t MAX_SACK_BLOCKS = 4;     //!< SACK blocks that fit in MAX_LENGTH
+    static constexpr uint8_t MAX_WINDOW_SCALE = 14;  //!< Largest window scale shift (RFC 7323 (2.3))
+
+    std::optional<uint16_t> mss{};          //!< Maximum segment size (RFC 9293), only on SYN segments
+    bool sack_permitted = false;            //!< SACK-permitted (RFC 2018), only on SYN segments
+    std::vector<SACKBlock> sack{};           //!< SACK blocks (RFC 2018), at most MAX_SACK_BLOCKS
+    std::optional<uint8_t> window_scale{};  //!< Window scale shift (RFC 7323), only on SYN segments
+
+    //! Parse `length` bytes of options from the provided NetParser
+    void parse(NetParser &p, size_t length);
+
+    //! Serialize the options, without padding
+    void serialize(std::string &s) const;
+
+    //! Length in bytes of serialize()'s output, padded to a multiple of 4
+    size_t length() const;
+
+    //! How many SACK blocks still fit next to the other options
+    size_t sack_room() const;
+
+    bool operator==(const TCPOptions &other) const;
+};
+
 //! \brief [TCP](\ref rfc::rfc793) segment header
-//! \note TCP options are not supported
+//! \note Only the options in TCPOptions are supported
 struct TCPHeader {
     static constexpr size_t LENGTH = 20;  //!< [TCP](\ref rfc::rfc793) header length, not including options
 
@@ -48,8 +86,12 @@ struct TCPHeader {
     uint16_t win = 0;           //!< window size
     uint16_t cksum = 0;         //!< checksum
     uint16_t uptr = 0;          //!< urgent pointer
+    TCPOptions options{};       //!< options, which must fit in `doff` (see update_doff())
     //!@}
 
+    //! Set `doff` to the length of the header including the current options
+    void update_doff() { doff = (LENGTH + options.length()) / 4; }
+
     //! Parse the TCP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
@@ -10,6 +10,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
@@ -18,48 +19,152 @@
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
-
 //  Eventloop while(condition) { poll(); handleEvents(); }
 //! \param[in] condition is a function returning true if loop should continue
-template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
-    auto base_time = timestamp_ms();
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_tcp_loop(const function<bool()> &condition) {
     while (condition()) {   //  while (true)
+        _advance_clock();
+        //  睡到下一个定时动作(RTO, delayed ACK, TIME_WAIT, ARP)到期, 而不是每隔固定的tick醒一次
+        _eventloop.cancel_timer(_tick_timer);
+        if (const auto timeout = _next_timeout()) {
+            _tick_timer = _eventloop.add_timer(*timeout, [&] { _advance_clock(); });
+        }
         // poll(); handleEvents();
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        auto ret = _eventloop.wait_next_event(-1);
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
-        //  passes time since last handling segs;  
-            //  tcpconnection 和 network interface 距离上次tick过去的时间 ; 告知他们. 做出相应变化。
-            //  tcp connection tick
-            //  network interface tick 
-        if (_tcp.value().active()) {
-            const auto next_time = timestamp_ms();
-            _tcp.value().tick(next_time - base_time);
-            _datagram_adapter.tick(next_time - base_time);
-            base_time = next_time;
+        //  owner调用了set_nodelay : 由tcp thread应用到TCPConnection上
+        if (const int nodelay = _nodelay.exchange(-1); nodelay >= 0) {
+            _advance_clock();
+            _tcp->set_nodelay(nodelay == 1);
+        }
+        //  in-process stream : 不管这次是被什么事件唤醒的, 都把两个方向能搬的数据搬完
+        //  (ACK腾出了发送缓冲区, 或者收到了新数据), owner只在我们可能在等它时才写eventfd
+        if constexpr (IN_PROCESS) {
+            _advance_clock();
+            _pump_stream(_thread_data);
+        }
+    }
+}
+
+//  rule 2 + rule 3 的in-process版本. 两边都读/写到0字节为止, 否则对端不一定会再唤醒我们 (见ByteRing)
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_pump_stream(RingStream &stream) {
+    //  owner写来的数据 -> TCPConnection
+    while (_tcp->active() and not _outbound_shutdown and _tcp->remaining_outbound_capacity() > 0) {
+        auto data = stream.read(_tcp->remaining_outbound_capacity());
+        if (data.empty()) {
+            if (stream.eof()) {
+                _finish_outbound();
+            }
+            break;
+        }
+        const auto len = data.size();
+        if (_tcp->write(move(data)) != len) {
+            throw runtime_error("TCPConnection::write() accepted less than advertised length");
+        }
+    }
+
+    //  TCPConnection收到的数据 -> owner
+    if (_inbound_shutdown) {
+        return;
+    }
+    ByteStream &inbound = _tcp->inbound_stream();
+    if (stream.closed_by_peer()) {
+        //  owner不再读了 : 丢掉
+        inbound.pop_output(inbound.buffer_size());
+    }
+    while (not inbound.buffer_empty()) {
+        const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
+        const size_t bytes_written = stream.write(inbound.peek_views(amount_to_write), false);
+        if (bytes_written == 0) {
+            break;
         }
+        inbound.pop_output(bytes_written);
+    }
+    if (inbound.eof() or inbound.error()) {
+        stream.shutdown(SHUT_WR);
+        _finish_inbound();
+    }
+}
+
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_finish_outbound() {
+    _tcp->end_input_stream();
+    _outbound_shutdown = true;
+
+    // debugging output:
+    cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string() << " finished ("
+         << _tcp.value().bytes_in_flight() << " byte" << (_tcp.value().bytes_in_flight() == 1 ? "" : "s")
+         << " still in flight).\n";
+}
+
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_finish_inbound() {
+    _inbound_shutdown = true;
+
+    // debugging output:
+    const ByteStream &inbound = _tcp->inbound_stream();
+    cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string() << " finished "
+         << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
+    if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
+        cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
+    }
+}
+
+//  passes time since last handling segs;
+//  tcpconnection 和 network interface 距离上次tick过去的时间 ; 告知他们. 做出相应变化。
+//  处理每个事件之前都要调用: 否则之后的tick会把事件之前流逝的时间算到事件新启动的定时器上 (如ACK重启的RTO)
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_advance_clock() {
+    const auto now = timestamp_ms();
+    if (_tcp.value().active() and now > _clock_ms) {
+        _tcp.value().tick(now - _clock_ms);
+        _datagram_adapter.tick(now - _clock_ms);
+        _clock_ms = now;
+    }
+}
+
+template <typename AdaptT, typename StreamT>
+optional<size_t> TCPSpongeSocket<AdaptT, StreamT>::_next_timeout() const {
+    if (not _tcp.value().active()) {
+        return nullopt;
+    }
+    const optional<size_t> tcp = _tcp.value().next_timeout();
+    const optional<size_t> adapter = _datagram_adapter.next_timeout();
+    if (tcp.has_value() and adapter.has_value()) {
+        return min(*tcp, *adapter);
     }
+    return tcp.has_value() ? tcp : adapter;
 }
 
-//! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_wake() {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(_wakeup.fd_num(), &one, sizeof(one)));
+}
+
+//! \param[in] data_stream_pair is a pair of connected streams (AF_UNIX SOCK_STREAM sockets, or a RingStream pair)
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
-template <typename AdaptT>
-TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> data_socket_pair,
-                                         AdaptT &&datagram_interface)
-    : LocalStreamSocket(move(data_socket_pair.first))
-    , _thread_data(move(data_socket_pair.second))
-    , _datagram_adapter(move(datagram_interface)) {
+template <typename AdaptT, typename StreamT>
+TCPSpongeSocket<AdaptT, StreamT>::TCPSpongeSocket(pair<StreamT, StreamT> data_stream_pair,
+                                                  AdaptT &&datagram_interface)
+    : StreamT(move(data_stream_pair.first))
+    , _thread_data(move(data_stream_pair.second))
+    , _datagram_adapter(move(datagram_interface))
+    , _wakeup(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
     _thread_data.set_blocking(false);
 }
 
 //  construct 本端 TCPConnection
 //  设置eventloop应该监听并如何处理的事情  ; set up what should the eventloop to poll and handle. 
-template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_initialize_TCP(const TCPConfig &config, const FdAdapterConfig &adapter_config) {
     _tcp.emplace(config);
+    _eventloop = EventLoop{adapter_config.event_loop};
+    _clock_ms = timestamp_ms();
 
     // Set up the event loop
 
@@ -79,21 +184,34 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     // 4) Outbound segment generated by TCP (needs to be
     //    given to underlying datagram socket)
 
+    // rule 0: owner wants attention (set_nodelay() or destruction); the loop itself then checks why
+    _eventloop.add_rule(
+        _wakeup,
+        Direction::In,
+        [&] { _wakeup.read(sizeof(uint64_t)); },
+        //  只要还可能有别的rule感兴趣就一直监听, 这样不会阻止eventloop在一切结束后Exit
+        [&] { return _tcp->active() or not _inbound_shutdown; });
+
     // rule 1: read from filtered packet stream and dump into TCPConnection
     //  event : adapter(网卡)的读事件(网卡有数据可读)
     _eventloop.add_rule(_datagram_adapter,      //  实际上注册的是底层Tapfd
                         Direction::In,
                         //  handler : 读出adaper的数据 向上交付给local tcp
                         [&] {
-                            auto seg = _datagram_adapter.read();        //  read and unwrap from ip to tcp  TCPOverIPv4OverEthernetAdapter::read()
+                            _advance_clock();
+                            //  一次唤醒尽量多读几个datagram (UDP: 一次recvmmsg), 而不是每个datagram都poll一次
+                            auto segs = _datagram_adapter.read_batch();
                             // cerr<<"read from filtered packet stream and dump into TCPConnection "<<endl;
                             //  tcp接收来自adapter的数据. 进行运输层的处理.
-                            if (seg) {
-                                _tcp->segment_received(move(seg.value()));
+                            for (auto &seg : segs) {
+                                if (not _tcp->active()) {
+                                    break;
+                                }
+                                _tcp->segment_received(move(seg));
                             }
 
                             // debugging output:
-                            if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
+                            if (_outbound_shutdown and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
                                 cerr << "DEBUG: Outbound stream to "
                                      << _datagram_adapter.config().destination.to_string()
                                      << " has been fully acknowledged.\n";
@@ -103,78 +221,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                         //  只有local tcp存活时 才监听并处理该事件
                         [&] { return _tcp->active(); });
 
-    //  user 写 _socket. 由于socket_pair,数据传送给 socket_thread_data ; tcp_thread 负责读出 _thread_data的数据 ，然受写入tcp 送入协议栈处理并从adapter发送出去
-    //  rule 2: read from pipe into outbound buffer
-    //  event : _thread_data的读事件. 即_thread_data接收到了_socket写入pipe的数据
-    _eventloop.add_rule(
-        _thread_data,           //  sockfd
-        Direction::In,
-        //  handler : tcp_thread 负责读出 _thread_data接收到的数据 ，然受写入tcp 送入协议栈处理并从adapter发送出去
-        [&] {
-            // cerr<<"read from pipe into outbound buffer"<<endl;
-            const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
-            const auto len = data.size();
-            const auto amount_written = _tcp->write(move(data));
-            if (amount_written != len) {
-                throw runtime_error("TCPConnection::write() accepted less than advertised length");
-            }
-            //  管道已空 且 _socket没有数据可写入_thread+data了.
-            //  _thread_data没有数据可送入协议栈
-            if (_thread_data.eof()) {
-                _tcp->end_input_stream();
-                _outbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
-                     << " finished (" << _tcp.value().bytes_in_flight() << " byte"
-                     << (_tcp.value().bytes_in_flight() == 1 ? "" : "s") << " still in flight).\n";
-            }
-        },
-        //  在local tcp存活 && 写不关闭 && local tcp outbound_buffer仍有空闲空间时 可监听并处理此事件
-        [&] { return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0); },
-        [&] {
-        //  移除事件时 关闭app写入tcp的bytestream ; shutdown = true
-            _tcp->end_input_stream();
-            _outbound_shutdown = true;
-        });
-
-    // rule 3: read from inbound buffer into pipe
-    //  event : _thread_data和_socket的管道不满即可触发
-    _eventloop.add_rule(
-        _thread_data,           //  sockfd
-        Direction::Out,
-        //  handler : 从tcp inbound buffer中弹出数据 并交由_thread_data写给_socket. 适时(inbound buffer读到eof）关闭_thread_data
-        [&] {
-            // cerr<<"read from inbound buffer into pipe"<<endl;
-            ByteStream &inbound = _tcp->inbound_stream();
-            // Write from the inbound_stream into
-            // the pipe, handling the possibility of a partial
-            // write (i.e., only pop what was actually written).
-            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
-            inbound.pop_output(bytes_written);
-
-            if (inbound.eof() or inbound.error()) {
-                _thread_data.shutdown(SHUT_WR);
-                _inbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string()
-                     << " finished " << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
-                if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
-                    cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
-                }
-            }
-        },
-        //  interest : 如果注册了该_data_socket的写事件到epoll上，那么只要pipe不满就会触发，则会陷入死循环。那么该如何正确的在poll上注册写事件 使得写事件可以在有数据写的时候发生，没有的时候就不发生？
-        //  解决方案如下：设置好注册写事件的先决条件. 也即 只有在有数据的时候才写(有数据时才把该写事件注册在poll上). 
-        //  并且 在不满足该条件时，就立刻将该写事件从poll上拿下来.
-        [&] {
-            //  tcp的inbound buffer不空(有数据可交付给上层app) || tcp的inbound buffer读到eof亦或者出错error (那就可以返回给上层eof或是error) 
-            return (not _tcp->inbound_stream().buffer_empty()) or
-                   ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
-        });
+    _add_thread_data_rules();
 
     // rule 4: read outbound segments from TCPConnection and send as datagrams
     //  event : adpater可写. 同rule3 注册不及时移除会死循环.
@@ -182,15 +229,87 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                         Direction::Out,
                         [&] {
                             // cerr<<"read outbound segments from TCPConnection and send as datagrams"<<endl;
-                            while (not _tcp->segments_out().empty()) {
-                                _datagram_adapter.write(_tcp->segments_out().front());
-                                _tcp->segments_out().pop();
-                            }
+                            _advance_clock();
+                            //  整个队列一起交给adapter (UDP: 一次sendmmsg)
+                            _datagram_adapter.write_batch(_tcp->segments_out());
                         },
                         //  interest : 如果tcp的outbound buffer有数据要可发 才注册 ; 不符合该条件时立刻移除
                         [&] { return not _tcp->segments_out().empty(); });
 }
 
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_add_thread_data_rules() {
+    //  rule 2 + rule 3 (in-process stream): owner可能在等我们时会写eventfd; 数据由_tcp_loop里的_pump_stream()搬运
+    if constexpr (IN_PROCESS) {
+        _eventloop.add_rule(
+            _thread_data.event_fd(),
+            Direction::In,
+            [&] { _thread_data.clear_event(); },
+            [&] { return _tcp->active() or not _inbound_shutdown; });
+    } else {
+        //  user 写 _socket. 由于socket_pair,数据传送给 socket_thread_data ; tcp_thread 负责读出 _thread_data的数据 ，然受写入tcp 送入协议栈处理并从adapter发送出去
+        //  rule 2: read from pipe into outbound buffer
+        //  event : _thread_data的读事件. 即_thread_data接收到了_socket写入pipe的数据
+        _eventloop.add_rule(
+            _thread_data,           //  sockfd
+            Direction::In,
+            //  handler : tcp_thread 负责读出 _thread_data接收到的数据 ，然受写入tcp 送入协议栈处理并从adapter发送出去
+            [&] {
+                // cerr<<"read from pipe into outbound buffer"<<endl;
+                _advance_clock();
+                auto data = _thread_data.read(_tcp->remaining_outbound_capacity());    //  非const, 才能move给tcp
+                const auto len = data.size();
+                const auto amount_written = _tcp->write(move(data));
+                if (amount_written != len) {
+                    throw runtime_error("TCPConnection::write() accepted less than advertised length");
+                }
+                //  管道已空 且 _socket没有数据可写入_thread+data了.
+                //  _thread_data没有数据可送入协议栈
+                if (_thread_data.eof()) {
+                    _finish_outbound();
+                }
+            },
+            //  在local tcp存活 && 写不关闭 && local tcp outbound_buffer仍有空闲空间时 可监听并处理此事件
+            [&] { return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0); },
+            [&] {
+            //  移除事件时 关闭app写入tcp的bytestream ; shutdown = true
+                _tcp->end_input_stream();
+                _outbound_shutdown = true;
+            });
+
+        // rule 3: read from inbound buffer into pipe
+        //  event : _thread_data和_socket的管道不满即可触发
+        _eventloop.add_rule(
+            _thread_data,           //  sockfd
+            Direction::Out,
+            //  handler : 从tcp inbound buffer中弹出数据 并交由_thread_data写给_socket. 适时(inbound buffer读到eof）关闭_thread_data
+            [&] {
+                // cerr<<"read from inbound buffer into pipe"<<endl;
+                ByteStream &inbound = _tcp->inbound_stream();
+                // Write from the inbound_stream into
+                // the pipe, handling the possibility of a partial
+                // write (i.e., only pop what was actually written).
+                // The views point straight into the stream's storage, so writev() copies from there.
+                const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
+                const auto bytes_written = _thread_data.write(inbound.peek_views(amount_to_write), false);
+                inbound.pop_output(bytes_written);
+
+                if (inbound.eof() or inbound.error()) {
+                    _thread_data.shutdown(SHUT_WR);
+                    _finish_inbound();
+                }
+            },
+            //  interest : 如果注册了该_data_socket的写事件到epoll上，那么只要pipe不满就会触发，则会陷入死循环。那么该如何正确的在poll上注册写事件 使得写事件可以在有数据写的时候发生，没有的时候就不发生？
+            //  解决方案如下：设置好注册写事件的先决条件. 也即 只有在有数据的时候才写(有数据时才把该写事件注册在poll上). 
+            //  并且 在不满足该条件时，就立刻将该写事件从poll上拿下来.
+            [&] {
+                //  tcp的inbound buffer不空(有数据可交付给上层app) || tcp的inbound buffer读到eof亦或者出错error (那就可以返回给上层eof或是error) 
+                return (not _tcp->inbound_stream().buffer_empty()) or
+                       ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
+            });
+    }
+}
+
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
 //! \param[in] type is the type of AF_UNIX sockets to create (e.g., SOCK_SEQPACKET)
 //! \returns a std::pair of connected sockets
@@ -201,20 +320,32 @@ static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int
     return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
 }
 
+//  owner和tcp thread之间的那对stream : socketpair, 或者(in-process)一对RingStream
+template <typename AdaptT, typename StreamT>
+pair<StreamT, StreamT> TCPSpongeSocket<AdaptT, StreamT>::_make_stream_pair() {
+    if constexpr (IN_PROCESS) {
+        return RingStream::make_pair(IN_PROCESS_STREAM_CAPACITY);
+    } else {
+        auto [owner_end, thread_end] = socket_pair_helper(SOCK_STREAM);
+        return {LocalStreamSocket(move(owner_end)), LocalStreamSocket(move(thread_end))};
+    }
+}
+
 //! \param[in] datagram_interface is the underlying interface (e.g. to UDP, IP, or Ethernet)
-template <typename AdaptT>
-TCPSpongeSocket<AdaptT>::TCPSpongeSocket(AdaptT &&datagram_interface)
-    : TCPSpongeSocket(socket_pair_helper(SOCK_STREAM), move(datagram_interface)) {}
+template <typename AdaptT, typename StreamT>
+TCPSpongeSocket<AdaptT, StreamT>::TCPSpongeSocket(AdaptT &&datagram_interface)
+    : TCPSpongeSocket(_make_stream_pair(), move(datagram_interface)) {}
 
 
 //  main thread join tcp thread
-template <typename AdaptT>
-TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
+template <typename AdaptT, typename StreamT>
+TCPSpongeSocket<AdaptT, StreamT>::~TCPSpongeSocket() {
     try {
         if (_tcp_thread.joinable()) {
             cerr << "Warning: unclean shutdown of TCPSpongeSocket\n";
             // force the other side to exit
             _abort.store(true);
+            _wake();
             _tcp_thread.join();     //  main thread 等待 eventloop thread结束
         }
     } catch (const exception &e) {
@@ -222,10 +353,10 @@ TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
     }
 }
 
-template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::wait_until_closed() {
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::wait_until_closed() {
     //  关闭user看到的_socketfd的读写   (对tcp的影响感觉是 _socket 关闭读写 -> _thread_data关闭读写 -> tcp关闭读写 发送fin? 日后再说 该睡觉了)
-    shutdown(SHUT_RDWR);
+    StreamT::shutdown(SHUT_RDWR);
     if (_tcp_thread.joinable()) {
         cerr << "DEBUG: Waiting for clean shutdown... ";    //  ? 这还clean ? 
         _tcp_thread.join();     //  等待tcp thread结束
@@ -235,13 +366,13 @@ void TCPSpongeSocket<AdaptT>::wait_until_closed() {
 
 //! \param[in] c_tcp is the TCPConfig for the TCPConnection
 //! \param[in] c_ad is the FdAdapterConfig for the FdAdapter
-template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::connect(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad) {
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::connect(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad) {
     if (_tcp) {
         throw runtime_error("connect() with TCPConnection already initialized");
     }
 
-    _initialize_TCP(c_tcp);
+    _initialize_TCP(c_tcp, c_ad);
 
     //  将local socket的{ip,port}告知_datagram_adapter
     _datagram_adapter.config_mut() = c_ad;
@@ -265,13 +396,13 @@ void TCPSpongeSocket<AdaptT>::connect(const TCPConfig &c_tcp, const FdAdapterCon
 
 //! \param[in] c_tcp is the TCPConfig for the TCPConnection
 //! \param[in] c_ad is the FdAdapterConfig for the FdAdapter
-template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::listen_and_accept(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad) {
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::listen_and_accept(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad) {
     if (_tcp) {
         throw runtime_error("listen_and_accept() with TCPConnection already initialized");
     }
 
-    _initialize_TCP(c_tcp);
+    _initialize_TCP(c_tcp, c_ad);
     //  将local socket的{ip,port}告知_datagram_adapter
     _datagram_adapter.config_mut() = c_ad;
     _datagram_adapter.set_listening(true);
@@ -302,16 +433,20 @@ void TCPSpongeSocket<AdaptT>::listen_and_accept(const TCPConfig &c_tcp, const Fd
 //  然后_thread_data 这个socketfd和_socket是一对 通过管道读写互相传递数据. (大概来讲就是tcp_thread操作_thraed_dtaa main_thread操作_socket)
 //  所以总共有3个fd
 
-template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::_tcp_main() {
+template <typename AdaptT, typename StreamT>
+void TCPSpongeSocket<AdaptT, StreamT>::_tcp_main() {
     try {
         if (not _tcp.has_value()) {
             throw runtime_error("no TCP");
         }
         //  while(true) {poll();(TCPSocket相关事件) ; handleEvents();}
         _tcp_loop([] { return true; });
-        //  关闭TCPSocket对应的fd
-        shutdown(SHUT_RDWR);
+        //  关闭TCPSocket对应的fd (in-process stream: 关闭tcp thread这一端, owner读完剩下的数据后看到eof)
+        if constexpr (IN_PROCESS) {
+            _thread_data.shutdown(SHUT_RDWR);
+        } else {
+            StreamT::shutdown(SHUT_RDWR);
+        }
         if (not _tcp.value().active()) {
             cerr << "DEBUG: TCP connection finished "
                  << (_tcp.value().state() == TCPState::State::RESET ? "uncleanly" : "cleanly.\n");
@@ -339,6 +474,12 @@ template class TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 //! Specialization of TCPSpongeSocket for LossyTCPOverIPv4OverTunFdAdapter
 template class TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
 
+//! Specialization of TCPSpongeSocket for TCPOverUDPSocketAdapter with an in-process stream
+template class TCPSpongeSocket<TCPOverUDPSocketAdapter, RingStream>;
+
+//! Specialization of TCPSpongeSocket for TCPOverIPv4OverEthernetAdapter with an in-process stream
+template class TCPSpongeSocket<TCPOverIPv4OverEthernetAdapter, RingStream>;
+
 CS144TCPSocket::CS144TCPSocket() : TCPOverIPv4SpongeSocket(TCPOverIPv4OverTunFdAdapter(TunFD("tun144"))) {}
 
 void CS144TCPSocket::connect(const Address &address) {
@@ -367,10 +508,11 @@ EthernetAddress random_private_ethernet_address() {
 }
 
 FullStackSocket::FullStackSocket()
-    : TCPOverIPv4OverEthernetSpongeSocket(TCPOverIPv4OverEthernetAdapter(TapFD("tap10"),
-                                                                         random_private_ethernet_address(),
-                                                                         Address(LOCAL_TAP_IP_ADDRESS, "0"),
-                                                                         Address(LOCAL_TAP_NEXT_HOP_ADDRESS, "0"))) {}
+    : InProcessTCPOverIPv4OverEthernetSpongeSocket(
+          TCPOverIPv4OverEthernetAdapter(TapFD("tap10"),
+                                         random_private_ethernet_address(),
+                                         Address(LOCAL_TAP_IP_ADDRESS, "0"),
+                                         Address(LOCAL_TAP_NEXT_HOP_ADDRESS, "0"))) {}
 
 void FullStackSocket::connect(const Address &address) {
     TCPConfig tcp_config;
@@ -385,5 +527,5 @@ void FullStackSocket::connect(const Address &address) {
     multiplexer_config.source = {LOCAL_TAP_IP_ADDRESS, to_string(uint16_t(random_device()()))};
     multiplexer_config.destination = address;
 
-    TCPOverIPv4OverEthernetSpongeSocket::connect(tcp_config, multiplexer_config);
+    InProcessTCPOverIPv4OverEthernetSpongeSocket::connect(tcp_config, multiplexer_config);
 }
@@ -6,6 +6,7 @@
 #include "fd_adapter.hh"
 #include "file_descriptor.hh"
 #include "network_interface.hh"
+#include "ring_stream.hh"
 #include "tcp_config.hh"
 #include "tcp_connection.hh"
 #include "tuntap_adapter.hh"
@@ -14,14 +15,20 @@
 #include <cstdint>
 #include <optional>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
-//! Multithreaded wrapper around TCPConnection that approximates the Unix sockets API
-template <typename AdaptT>
-class TCPSpongeSocket : public LocalStreamSocket {
+//! \brief Multithreaded wrapper around TCPConnection that approximates the Unix sockets API
+//! \tparam StreamT is the owner's end of the stream to the TCPConnection thread: a LocalStreamSocket, or a
+//! RingStream to keep the data in the process (see InProcessTCPSpongeSocket)
+template <typename AdaptT, typename StreamT = LocalStreamSocket>
+class TCPSpongeSocket : public StreamT {
   private:
-    //! Stream socket for reads and writes between owner and TCP thread
-    LocalStreamSocket _thread_data;
+    //! Does the owner talk to the TCPConnection thread through a RingStream instead of a socket pair?
+    static constexpr bool IN_PROCESS = std::is_same_v<StreamT, RingStream>;
+
+    //! Stream (socket or RingStream) for reads and writes between owner and TCP thread
+    StreamT _thread_data;
 
   protected:
     //! Adapter to underlying datagram socket (e.g., UDP or IP)
@@ -29,7 +36,7 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
   private:
     //! Set up the TCPConnection and the event loop
-    void _initialize_TCP(const TCPConfig &config);
+    void _initialize_TCP(const TCPConfig &config, const FdAdapterConfig &adapter_config);
 
     //! TCP state machine
     std::optional<TCPConnection> _tcp{};
@@ -47,11 +54,52 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //  不是mainthread,是负责eventloop的那个thread
     std::thread _tcp_thread{};
 
-    //! Construct LocalStreamSocket fds from socket pair, initialize eventloop
-    TCPSpongeSocket(std::pair<FileDescriptor, FileDescriptor> data_socket_pair, AdaptT &&datagram_interface);
+    //! Construct from a connected pair of streams, initialize eventloop
+    TCPSpongeSocket(std::pair<StreamT, StreamT> data_stream_pair, AdaptT &&datagram_interface);
+
+    //! A socket pair, or a RingStream pair of IN_PROCESS_STREAM_CAPACITY
+    static std::pair<StreamT, StreamT> _make_stream_pair();
 
     std::atomic_bool _abort{false};  //!< Flag used by the owner to force the TCPConnection thread to shut down
 
+    //! Owner's TCP_NODELAY setting, applied by the TCPConnection thread (empty until set_nodelay() is called)
+    std::atomic<int> _nodelay{-1};
+
+    //! [eventfd(2)](\ref man2::eventfd) that the owner writes to wake the TCPConnection thread (see _wake())
+    FileDescriptor _wakeup;
+
+    //! \name Timekeeping of the TCPConnection thread
+    //!@{
+    uint64_t _clock_ms{0};                //!< timestamp_ms() when the TCPConnection and adapter were last ticked
+    EventLoop::TimerId _tick_timer{0};  //!< timer for the next deadline of either one
+
+    //! Tick the TCPConnection and the adapter up to the present
+    void _advance_clock();
+
+    //! Milliseconds until the TCPConnection or the adapter next needs a tick, if ever
+    std::optional<size_t> _next_timeout() const;
+    //!@}
+
+    //! Make the TCPConnection thread's current or next wait_next_event() return (owner thread)
+    void _wake();
+
+    //! \name In-process stream between owner and TCP thread (StreamT is RingStream)
+    //!@{
+    static constexpr size_t IN_PROCESS_STREAM_CAPACITY = 65536;  //!< Bytes buffered in each direction
+
+    //! Move bytes between the thread's end of the RingStream and the TCPConnection until neither side can take more
+    void _pump_stream(RingStream &stream);
+    //!@}
+
+    //! Add the rules that move bytes between _thread_data and the TCPConnection
+    void _add_thread_data_rules();
+
+    //! The owner has finished writing: end the TCPConnection's outbound stream
+    void _finish_outbound();
+
+    //! The owner has been told that the inbound stream ended (cleanly or with an error)
+    void _finish_inbound();
+
     bool _inbound_shutdown{false};  //!< Has TCPSpongeSocket shut down the incoming data to the owner?
 
     bool _outbound_shutdown{false};  //!< Has the owner shut down the outbound data to the TCP connection?
@@ -62,6 +110,13 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Construct from the interface that the TCPConnection thread will use to read and write datagrams
     explicit TCPSpongeSocket(AdaptT &&datagram_interface);
 
+    //! \brief Disable Nagle's algorithm (like TCP_NODELAY) for latency-sensitive flows, or enable it again
+    //! \details Overrides TCPConfig::nagle; takes effect at once if the connection is already running.
+    void set_nodelay(const bool nodelay) {
+        _nodelay = nodelay;
+        _wake();
+    }
+
     //! Close socket, and wait for TCPConnection to finish
     //! \note Calling this function is only advisable if the socket has reached EOF,
     //! or else may wait foreever for remote peer to close the TCP connection.
@@ -88,6 +143,7 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
     //! \name
     //! Some methods of the parent Socket wouldn't work as expected on the TCP socket, so delete them
+    //! (a RingStream has none of them)
 
     //!@{
     void bind(const Address &address) = delete;
@@ -104,6 +160,15 @@ using TCPOverIPv4OverEthernetSpongeSocket = TCPSpongeSocket<TCPOverIPv4OverEther
 using LossyTCPOverUDPSpongeSocket = TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 using LossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
 
+//! \brief A TCPSpongeSocket whose owner reads and writes a RingStream instead of a socket
+//! \details For owners in the same process as the TCPConnection thread: the data skips the socket pair's system
+//! calls and kernel copies. The socket is not a FileDescriptor, so it can't be handed to code that expects one.
+template <typename AdaptT>
+using InProcessTCPSpongeSocket = TCPSpongeSocket<AdaptT, RingStream>;
+
+using InProcessTCPOverUDPSpongeSocket = InProcessTCPSpongeSocket<TCPOverUDPSocketAdapter>;
+using InProcessTCPOverIPv4OverEthernetSpongeSocket = InProcessTCPSpongeSocket<TCPOverIPv4OverEthernetAdapter>;
+
 //! \class TCPSpongeSocket
 //! This class involves the simultaneous operation of two threads.
 //!
@@ -131,8 +196,8 @@ class CS144TCPSocket : public TCPOverIPv4SpongeSocket {
     void connect(const Address &address);
 };
 
-//! Helper class that makes a TCPOverIPv4overEthernetSpongeSocket behave more like a (kernel) TCPSocket
-class FullStackSocket : public TCPOverIPv4OverEthernetSpongeSocket {
+//! Helper class that makes an InProcessTCPOverIPv4OverEthernetSpongeSocket behave more like a (kernel) TCPSocket
+class FullStackSocket : public InProcessTCPOverIPv4OverEthernetSpongeSocket {
   public:
     //! Construct a TCP (stream) socket, using the CS144 TCPConnection object,
     //! that encapsulates TCP segments in IP datagrams, then encapsulates
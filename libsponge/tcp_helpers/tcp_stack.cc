@@ -0,0 +1,487 @@
+#include "tcp_stack.hh"
+
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+size_t FourTupleHash::operator()(const FourTuple &tuple) const noexcept {
+    //  四元组拼成两个64位数, 乘法混合后折叠
+    const uint64_t addresses = (uint64_t{tuple.local_address} << 32) | tuple.remote_address;
+    const uint64_t ports = (uint64_t{tuple.local_port} << 16) | tuple.remote_port;
+    const uint64_t h = (addresses ^ (ports * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 31);
+}
+
+//! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
+static pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int type) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, type, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+TCPStack::Connection::Connection(const TCPConfig &cfg, pair<FileDescriptor, FileDescriptor> socket_pair)
+    : tcp(cfg)
+    , socket(move(socket_pair.first))
+    , owner_end(LocalStreamSocket(move(socket_pair.second)))
+    , clock_ms(timestamp_ms()) {}
+
+//! \param[in] device carries one IPv4 datagram per read() and write() (e.g. a TunFD)
+//! \param[in] address is the stack's IPv4 address; datagrams to other addresses are ignored
+//! \param[in] cfg is the TCPConfig of every connection
+//! \param[in] backend is how each shard's thread waits for the device and its connections' sockets
+//! \param[in] shards is the number of threads that the connections are divided among
+TCPStack::TCPStack(TunTapFD &&device,
+                   const Address &address,
+                   const TCPConfig &cfg,
+                   const EventLoop::Backend backend,
+                   const size_t shards)
+    : _cfg(cfg), _address(address.ipv4_numeric()) {
+    if (shards == 0) {
+        throw runtime_error("TCPStack needs at least one shard");
+    }
+    //  其他shard只写设备, 各用一个dup出来的描述符
+    vector<TunTapFD> devices;
+    for (size_t i = 1; i < shards; ++i) {
+        devices.emplace_back(FileDescriptor(SystemCall("dup", ::dup(device.fd_num()))));
+    }
+    devices.insert(devices.begin(), move(device));
+    _start(move(devices), false, backend);
+}
+
+//! \param[in] queues are the queues of one device (e.g. from TunFD::open_queues), one per shard
+//! \param[in] address is the stack's IPv4 address; datagrams to other addresses are ignored
+//! \param[in] cfg is the TCPConfig of every connection
+//! \param[in] backend is how each shard's thread waits for its queue and its connections' sockets
+TCPStack::TCPStack(vector<TunTapFD> &&queues,
+                   const Address &address,
+                   const TCPConfig &cfg,
+                   const EventLoop::Backend backend)
+    : _cfg(cfg), _address(address.ipv4_numeric()) {
+    if (queues.empty()) {
+        throw runtime_error("TCPStack needs at least one queue");
+    }
+    _start(move(queues), true, backend);
+}
+
+void TCPStack::_start(vector<TunTapFD> &&devices, const bool every_shard_reads, const EventLoop::Backend backend) {
+    //  先建好所有shard (各自的inbox), 再启动线程: 读设备的shard一启动就可能往别的shard投递
+    _shards.resize(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        _shards[i] = make_unique<Shard>(*this, i, move(devices[i]), every_shard_reads or i == 0, backend);
+    }
+    for (auto &shard : _shards) {
+        shard->start();
+    }
+}
+
+TCPStack::Shard::Shard(TCPStack &stack,
+                       const size_t index,
+                       TunTapFD &&device,
+                       const bool reads_device,
+                       const EventLoop::Backend backend)
+    : _stack(stack)
+    , _index(index)
+    , _device(move(device))
+    , _reads_device(reads_device)
+    , _eventloop(backend)
+    , _random(get_random_generator())
+    , _wakeup(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
+    for (size_t i = 0; i < _stack._shards.size(); ++i) {
+        _inboxes.push_back(make_unique<Inbox>(INBOX_CAPACITY));
+    }
+
+    //  别的shard投递了datagram, owner排了connect请求, 或者要析构
+    _eventloop.add_rule(_wakeup, Direction::In, [&] {
+        _wakeup.read(sizeof(uint64_t));
+        //  每次唤醒都取空: 投递方只在inbox从空变为非空时才唤醒
+        for (auto &inbox : _inboxes) {
+            while (auto dgram = inbox->pop()) {
+                _datagram_received(*dgram);
+            }
+        }
+        _start_connect_requests();
+    });
+
+    //  设备上的每个datagram: 按四元组的hash交给对应的shard (TunTapFD::read复用同一块缓冲区)
+    if (_reads_device) {
+        _eventloop.add_rule(_device, Direction::In, [&] {
+            InternetDatagram dgram;
+            if (dgram.parse(_device.read()) == ParseResult::NoError) {
+                _steer(move(dgram));
+            }
+        });
+    }
+
+    //  有segment要发的连接: 统一在设备可写时发出
+    _eventloop.add_rule(
+        _device,
+        Direction::Out,
+        [&] {
+            for (const auto &tuple : _outbound) {
+                const auto it = _connections.find(tuple);
+                if (it == _connections.end()) {
+                    continue;
+                }
+                it->second->queued = false;
+                auto &segments = it->second->tcp.segments_out();
+                while (not segments.empty()) {
+                    _send(tuple, segments.front());
+                    segments.pop();
+                }
+            }
+            _outbound.clear();
+        },
+        [&] { return not _outbound.empty(); });
+}
+
+void TCPStack::Shard::start() { _thread = thread(&Shard::_main, this); }
+
+void TCPStack::Shard::wake() {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(_wakeup.fd_num(), &one, sizeof(one)));
+}
+
+void TCPStack::Shard::join() {
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void TCPStack::Shard::_main() {
+    try {
+        while (not _stack._abort) {
+            _eventloop.wait_next_event(-1);
+            //  rule的回调里还引用着连接, 等这一轮事件处理完再删除
+            _remove_finished();
+        }
+        _abort_connections();
+    } catch (const exception &e) {
+        cerr << "Exception in TCPStack shard " << _index << ": " << e.what() << "\n";
+        throw;
+    }
+}
+
+void TCPStack::Shard::_steer(InternetDatagram &&dgram) {
+    if (dgram.header().proto != IPv4Header::PROTO_TCP or dgram.header().dst != _stack._address) {
+        return;
+    }
+    //  只取端口号算hash, 不解析整个TCP段: 校验和留给连接所在的shard去算
+    const Buffer payload = dgram.payload();
+    if (payload.size() < 4) {
+        return;
+    }
+    const auto sport = static_cast<uint16_t>(payload.at(0) << 8 | payload.at(1));
+    const auto dport = static_cast<uint16_t>(payload.at(2) << 8 | payload.at(3));
+    const size_t shard = _stack._shard_of({_stack._address, dgram.header().src, dport, sport});
+    if (shard == _index) {
+        _datagram_received(dgram);
+    } else {
+        _stack._shards[shard]->deliver(_index, move(dgram));
+    }
+}
+
+//! \param[in] from is the index of the calling shard; only its thread pushes to this shard's inbox from it
+void TCPStack::Shard::deliver(const size_t from, InternetDatagram &&dgram) {
+    if (_inboxes[from]->push(move(dgram)) == Inbox::PushResult::First) {
+        wake();
+    }
+}
+
+void TCPStack::Shard::_datagram_received(const InternetDatagram &dgram) {
+    TCPSegment seg;
+    if (seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError) {
+        return;
+    }
+
+    const FourTuple tuple{_stack._address, dgram.header().src, seg.header().dport, seg.header().sport};
+    const auto it = _connections.find(tuple);
+    if (it == _connections.end()) {
+        //  新连接只能由发往监听端口的SYN建立; 其余的回RST (RST本身不回应)
+        if (seg.header().rst) {
+            return;
+        }
+        bool listening = false;
+        if (seg.header().syn and not seg.header().ack) {
+            lock_guard<mutex> lock(_stack._mutex);
+            listening = _stack._listeners.count(tuple.local_port) > 0;
+        }
+        if (not listening) {
+            _reset(tuple, seg);
+            return;
+        }
+        Connection &conn = _add_connection(tuple);
+        conn.tcp.segment_received(seg);
+        _after_event(tuple, conn);
+        return;
+    }
+
+    Connection &conn = *it->second;
+    if (not conn.tcp.active()) {
+        return;  //  已结束, 只是还有数据没交给owner
+    }
+    _advance_clock(conn);
+    conn.tcp.segment_received(seg);
+    _after_event(tuple, conn);
+}
+
+//  RFC 793 (3.4 Reset Generation): 有ACK就用对方的ackno作seqno, 否则ack对方占用的序列号
+void TCPStack::Shard::_reset(const FourTuple &tuple, const TCPSegment &seg) {
+    TCPSegment rst;
+    rst.header().rst = true;
+    if (seg.header().ack) {
+        rst.header().seqno = seg.header().ackno;
+    } else {
+        rst.header().ack = true;
+        rst.header().ackno = seg.header().seqno + seg.length_in_sequence_space();
+    }
+    _send(tuple, rst);
+}
+
+void TCPStack::Shard::_send(const FourTuple &tuple, TCPSegment &seg) {
+    seg.header().sport = tuple.local_port;
+    seg.header().dport = tuple.remote_port;
+
+    InternetDatagram dgram;
+    dgram.header().src = tuple.local_address;
+    dgram.header().dst = tuple.remote_address;
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+
+    _device.write(dgram.serialize());
+}
+
+//  和TCPSpongeSocket的rule 2, 3相同, 只是每个连接各有一对
+TCPStack::Connection &TCPStack::Shard::_add_connection(const FourTuple &tuple) {
+    auto &slot = _connections[tuple];
+    slot = make_unique<Connection>(_stack._cfg, socket_pair_helper(SOCK_STREAM));
+    Connection *conn = slot.get();
+    conn->socket.set_blocking(false);
+
+    //  owner写来的数据 -> TCPConnection
+    _eventloop.add_rule(
+        conn->socket,
+        Direction::In,
+        [this, conn, tuple] {
+            _advance_clock(*conn);
+            auto data = conn->socket.read(conn->tcp.remaining_outbound_capacity());
+            const auto len = data.size();
+            if (conn->tcp.write(move(data)) != len) {
+                throw runtime_error("TCPConnection::write() accepted less than advertised length");
+            }
+            if (conn->socket.eof()) {
+                conn->tcp.end_input_stream();
+                conn->outbound_shutdown = true;
+            }
+            _after_event(tuple, *conn);
+        },
+        [conn] {
+            return conn->tcp.active() and not conn->outbound_shutdown and conn->tcp.remaining_outbound_capacity() > 0;
+        });
+
+    //  TCPConnection收到的数据 -> owner
+    _eventloop.add_rule(
+        conn->socket,
+        Direction::Out,
+        [this, conn, tuple] {
+            ByteStream &inbound = conn->tcp.inbound_stream();
+            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
+            inbound.pop_output(conn->socket.write(inbound.peek_views(amount_to_write), false));
+            if (inbound.eof() or inbound.error()) {
+                conn->socket.shutdown(SHUT_WR);
+                conn->inbound_shutdown = true;
+            }
+            _after_event(tuple, *conn);
+        },
+        [conn] {
+            const ByteStream &inbound = conn->tcp.inbound_stream();
+            return not inbound.buffer_empty() or ((inbound.eof() or inbound.error()) and not conn->inbound_shutdown);
+        });
+
+    return *conn;
+}
+
+void TCPStack::Shard::connect(ConnectRequest *request) {
+    {
+        lock_guard<mutex> lock(_stack._mutex);
+        _connect_requests.push_back(request);
+    }
+    wake();
+}
+
+void TCPStack::Shard::_start_connect_requests() {
+    vector<ConnectRequest *> requests;
+    {
+        lock_guard<mutex> lock(_stack._mutex);
+        swap(requests, _connect_requests);
+    }
+    for (ConnectRequest *request : requests) {
+        //  本地端口要选得让四元组hash到本shard, 对方的回应才会被交给这里
+        FourTuple tuple{_stack._address, request->peer.ipv4_numeric(), 0, request->peer.port()};
+        constexpr uint32_t ephemeral_ports = 65536 - EPHEMERAL_PORT_FIRST;
+        do {
+            tuple.local_port = EPHEMERAL_PORT_FIRST + _random() % ephemeral_ports;
+        } while (_stack._shard_of(tuple) != _index or _connections.count(tuple) > 0);
+
+        Connection &conn = _add_connection(tuple);
+        conn.request = request;
+        conn.tcp.connect();
+        _after_event(tuple, conn);
+    }
+}
+
+void TCPStack::Shard::_advance_clock(Connection &conn) {
+    const auto now = timestamp_ms();
+    if (conn.tcp.active() and now > conn.clock_ms) {
+        conn.tcp.tick(now - conn.clock_ms);
+        conn.clock_ms = now;
+    }
+}
+
+void TCPStack::Shard::_after_event(const FourTuple &tuple, Connection &conn) {
+    if (not conn.tcp.segments_out().empty() and not conn.queued) {
+        conn.queued = true;
+        _outbound.push_back(tuple);
+    }
+
+    //  握手完成: 把owner那一端交给accept()或connect()
+    if (conn.owner_end.has_value()) {
+        const TCPState state = conn.tcp.state();
+        if (state == TCPState::State::ESTABLISHED or state == TCPState::State::CLOSE_WAIT) {
+            {
+                lock_guard<mutex> lock(_stack._mutex);
+                if (conn.request) {
+                    conn.request->result = move(conn.owner_end);
+                    conn.request->done = true;
+                    conn.request = nullptr;
+                } else {
+                    _stack._listeners[tuple.local_port].push_back(move(*conn.owner_end));
+                }
+            }
+            conn.owner_end.reset();
+            _stack._changed.notify_all();
+        }
+    }
+
+    //  每个连接一个定时器, 定在它下一个定时动作到期时
+    _eventloop.cancel_timer(conn.timer);
+    conn.timer = 0;
+    if (const auto timeout = conn.tcp.next_timeout()) {
+        conn.timer = _eventloop.add_timer(*timeout, [this, tuple] {
+            const auto it = _connections.find(tuple);
+            if (it != _connections.end()) {
+                _advance_clock(*it->second);
+                _after_event(tuple, *it->second);
+            }
+        });
+    }
+
+    if (not conn.tcp.active()) {
+        if (conn.request) {
+            {
+                lock_guard<mutex> lock(_stack._mutex);
+                conn.request->error = "connection to " + conn.request->peer.to_string() + " failed";
+                conn.request->done = true;
+                conn.request = nullptr;
+            }
+            _stack._changed.notify_all();
+        }
+        _finished.push_back(tuple);
+    }
+}
+
+void TCPStack::Shard::_remove_finished() {
+    for (const auto &tuple : _finished) {
+        const auto it = _connections.find(tuple);
+        if (it == _connections.end()) {
+            continue;
+        }
+        Connection &conn = *it->second;
+        //  已经交给owner的连接, 要等收到的数据全部写进socket
+        if (conn.tcp.active() or (not conn.owner_end.has_value() and not conn.inbound_shutdown)) {
+            continue;
+        }
+        _eventloop.cancel_timer(conn.timer);
+        //  rule持有socket的副本: 显式关闭, EventLoop才会取消这些rule
+        conn.socket.close();
+        _connections.erase(it);
+    }
+    _finished.clear();
+}
+
+void TCPStack::Shard::_abort_connections() {
+    try {
+        for (auto &[tuple, conn] : _connections) {
+            conn->tcp.abort();
+            auto &segments = conn->tcp.segments_out();
+            while (not segments.empty()) {
+                _send(tuple, segments.front());
+                segments.pop();
+            }
+        }
+    } catch (const unix_error &) {
+        //  设备的另一端已经关闭(比如对面的stack先析构了): RST发不出去, 也就不用再发
+    }
+}
+
+//! \param[in] port is the local port; SYNs to it create connections that accept() returns
+void TCPStack::listen(const uint16_t port) {
+    lock_guard<mutex> lock(_mutex);
+    _listeners.try_emplace(port);
+}
+
+//! \param[in] port is a port passed to listen()
+//! \returns the owner's end of the first established connection to `port` that hasn't been accepted
+LocalStreamSocket TCPStack::accept(const uint16_t port) {
+    unique_lock<mutex> lock(_mutex);
+    const auto listener = _listeners.find(port);
+    if (listener == _listeners.end()) {
+        throw runtime_error("TCPStack::accept() on port " + to_string(port) + ", which isn't listening");
+    }
+    auto &queue = listener->second;
+    _changed.wait(lock, [&] { return not queue.empty(); });
+    LocalStreamSocket socket = move(queue.front());
+    queue.pop_front();
+    return socket;
+}
+
+//! \param[in] peer is the address and port to connect to
+//! \returns the owner's end of the established connection
+LocalStreamSocket TCPStack::connect(const Address &peer) {
+    ConnectRequest request{peer};
+    Shard *shard = nullptr;
+    {
+        lock_guard<mutex> lock(_mutex);
+        shard = _shards[_next_shard++ % _shards.size()].get();
+    }
+    shard->connect(&request);
+
+    unique_lock<mutex> lock(_mutex);
+    _changed.wait(lock, [&] { return request.done; });
+    if (not request.result.has_value()) {
+        throw runtime_error("TCPStack::connect(): " + request.error);
+    }
+    return move(*request.result);
+}
+
+TCPStack::~TCPStack() {
+    try {
+        _abort = true;
+        for (auto &shard : _shards) {
+            shard->wake();
+            shard->join();
+        }
+    } catch (const exception &e) {
+        cerr << "Exception destructing TCPStack: " << e.what() << endl;
+    }
+}
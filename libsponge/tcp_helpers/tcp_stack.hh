@@ -0,0 +1,209 @@
+#ifndef SPONGE_LIBSPONGE_TCP_STACK_HH
+#define SPONGE_LIBSPONGE_TCP_STACK_HH
+
+#include "address.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "ipv4_datagram.hh"
+#include "socket.hh"
+#include "spsc_queue.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tun.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Identifies a TCP connection: both IPv4 addresses and both ports, in host byte order
+struct FourTuple {
+    uint32_t local_address{0};
+    uint32_t remote_address{0};
+    uint16_t local_port{0};
+    uint16_t remote_port{0};
+
+    bool operator==(const FourTuple &other) const {
+        return local_address == other.local_address and remote_address == other.remote_address and
+               local_port == other.local_port and remote_port == other.remote_port;
+    }
+};
+
+//! Hash of a FourTuple, for the connection table and for choosing a connection's shard
+struct FourTupleHash {
+    size_t operator()(const FourTuple &tuple) const noexcept;
+};
+
+//! \brief Many TCPConnections sharing one IPv4 device, each exposed to the owner as a LocalStreamSocket
+//! \details The device is a TunTapFD: a TunFD, or any descriptor that carries one IPv4 datagram per read() and
+//! write(). The connections are divided among one or more shards by the hash of their FourTuple, as a NIC's
+//! receive-side scaling would; each shard has a thread, an EventLoop and its part of the connection table, so a
+//! TCPConnection is only ever touched by one thread. Shard 0 reads the device and hands each datagram that
+//! belongs to another shard over through an SPSCQueue; every shard writes its own segments to the device.
+//!
+//! Given the queues of a multiqueue TUN device instead (see TunFD::open_queues), every shard reads and writes its
+//! own queue, and steers only the datagrams that the kernel put on the wrong one. Since the kernel sends a flow's
+//! datagrams to the queue that the flow was last written to, that is mostly the first segment of a connection.
+class TCPStack {
+  private:
+    //! A connect() call, handed to a shard
+    struct ConnectRequest {
+        Address peer;
+        std::optional<LocalStreamSocket> result{};
+        std::string error{};
+        bool done{false};
+    };
+
+    //! A connection and the stack's end of the socket pair whose other end the owner gets
+    struct Connection {
+        TCPConnection tcp;
+        LocalStreamSocket socket;                    //!< the stack's end
+        std::optional<LocalStreamSocket> owner_end;  //!< until accept() or connect() hands it over
+        uint64_t clock_ms;                           //!< timestamp_ms() when `tcp` was last ticked
+        EventLoop::TimerId timer{0};                 //!< fires at `tcp`'s next deadline
+        bool inbound_shutdown{false};                //!< has `socket` been shut down for writing?
+        bool outbound_shutdown{false};               //!< has the owner finished writing?
+        bool queued{false};                          //!< is it in its shard's list of connections to send from?
+        ConnectRequest *request{nullptr};            //!< the connect() call waiting for it, if any
+
+        Connection(const TCPConfig &cfg, std::pair<FileDescriptor, FileDescriptor> socket_pair);
+        Connection(const Connection &other) = delete;
+        Connection &operator=(const Connection &other) = delete;
+    };
+
+    //! Datagrams read by one shard for connections of another
+    using Inbox = SPSCQueue<InternetDatagram>;
+
+    static constexpr uint16_t EPHEMERAL_PORT_FIRST = 49152;  //!< Lowest local port that connect() picks (RFC 6335)
+    static constexpr size_t INBOX_CAPACITY = 1024;  //!< Datagrams waiting for a shard; more are dropped
+
+    //! A thread that runs the connections whose FourTuple hashes to it
+    class Shard {
+      private:
+        TCPStack &_stack;
+        size_t _index;
+        TunTapFD _device;        //!< this shard's own descriptor of the device
+        bool _reads_device;      //!< does this shard read the device and steer datagrams to the others?
+        EventLoop _eventloop;
+
+        std::unordered_map<FourTuple, std::unique_ptr<Connection>, FourTupleHash> _connections{};
+        std::vector<FourTuple> _outbound{};  //!< connections with segments to send
+        std::vector<FourTuple> _finished{};  //!< connections to remove once the current events have been handled
+        std::mt19937 _random;                //!< picks ephemeral ports
+
+        std::vector<std::unique_ptr<Inbox>> _inboxes{};     //!< one from each shard, by index
+        std::vector<ConnectRequest *> _connect_requests{};  //!< under TCPStack::_mutex
+        FileDescriptor _wakeup;  //!< eventfd written after queueing a datagram, a connect() or destruction
+        std::thread _thread{};
+
+        void _main();
+
+        //! Give a datagram read from the device to its shard
+        void _steer(InternetDatagram &&dgram);
+        //! Parse a datagram's segment and give it to the connection it belongs to
+        void _datagram_received(const InternetDatagram &dgram);
+        //! Answer a segment that belongs to no connection with a RST
+        void _reset(const FourTuple &tuple, const TCPSegment &seg);
+        //! Write a segment to the device, addressed by `tuple`
+        void _send(const FourTuple &tuple, TCPSegment &seg);
+
+        //! Add a connection to the table, with the rules that copy data between it and its socket
+        Connection &_add_connection(const FourTuple &tuple);
+        //! Start the connections asked for by connect()
+        void _start_connect_requests();
+        //! Tick a connection's TCPConnection up to the current time
+        void _advance_clock(Connection &conn);
+        //! After `conn` has handled an event: queue its segments, hand it over, rearm its timer, or finish it
+        void _after_event(const FourTuple &tuple, Connection &conn);
+        //! Remove the connections in _finished that are done
+        void _remove_finished();
+        //! On TCPStack::_abort: reset the connections that are still active, writing their RSTs to the device
+        void _abort_connections();
+
+      public:
+        Shard(TCPStack &stack,
+              const size_t index,
+              TunTapFD &&device,
+              const bool reads_device,
+              const EventLoop::Backend backend);
+
+        //! Start the shard's thread
+        void start();
+        //! Wake the shard's thread (to notice a queued connect() or TCPStack::_abort)
+        void wake();
+        //! Wait for the shard's thread to finish
+        void join();
+
+        //! From shard `from`'s thread: queue a datagram for this shard (dropped if the inbox is full)
+        void deliver(const size_t from, InternetDatagram &&dgram);
+        //! From the owner: open a connection to `request->peer`, and complete `request` once it's established
+        void connect(ConnectRequest *request);
+
+        Shard(const Shard &other) = delete;
+        Shard &operator=(const Shard &other) = delete;
+    };
+
+    TCPConfig _cfg;
+    uint32_t _address;  //!< the stack's IPv4 address, in host byte order
+    std::atomic_bool _abort{false};
+    std::vector<std::unique_ptr<Shard>> _shards{};
+
+    //! \name Shared by the owner and the shards, under _mutex
+    //!@{
+    std::mutex _mutex{};
+    std::condition_variable _changed{};
+    std::unordered_map<uint16_t, std::deque<LocalStreamSocket>> _listeners{};  //!< accept queue of each port
+    size_t _next_shard{0};  //!< where the next connect() goes
+    //!@}
+
+    //! Create a shard for each device (reading it if `every_shard_reads`, or else only shard 0 reads) and start them
+    void _start(std::vector<TunTapFD> &&devices, const bool every_shard_reads, const EventLoop::Backend backend);
+
+    //! The shard that runs the connection identified by `tuple`
+    size_t _shard_of(const FourTuple &tuple) const { return FourTupleHash{}(tuple) % _shards.size(); }
+
+  public:
+    //! Run a stack with address `address` on `device`, with `shards` threads; connections use `cfg`
+    TCPStack(TunTapFD &&device,
+             const Address &address,
+             const TCPConfig &cfg = {},
+             const EventLoop::Backend backend = EventLoop::Backend::Poll,
+             const size_t shards = 1);
+
+    //! Run a stack with address `address` on the queues of a multiqueue device, with a thread for each queue
+    TCPStack(std::vector<TunTapFD> &&queues,
+             const Address &address,
+             const TCPConfig &cfg = {},
+             const EventLoop::Backend backend = EventLoop::Backend::Poll);
+
+    //! Accept connections to `port`
+    void listen(const uint16_t port);
+
+    //! Wait for an established connection to a port passed to listen()
+    LocalStreamSocket accept(const uint16_t port);
+
+    //! Open a connection to `peer` from an ephemeral port, and wait until it is established
+    LocalStreamSocket connect(const Address &peer);
+
+    //! Abort the connections that are left (sending each peer a RST) and stop the shards' threads
+    ~TCPStack();
+
+    //! \name
+    //! The shards' threads refer to the stack, so a TCPStack can't be copied or moved
+
+    //!@{
+    TCPStack(const TCPStack &other) = delete;
+    TCPStack &operator=(const TCPStack &other) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_STACK_HH
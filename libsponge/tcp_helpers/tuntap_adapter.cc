@@ -14,22 +14,29 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
     // Linux seems to ignore the first frame sent on a TAP device, so send a dummy frame to prime the pump :-(
     EthernetFrame dummy_frame;
     _tap.write(dummy_frame.serialize());
+    //  read_batch()要读到EAGAIN为止
+    _tap.set_blocking(false);
 }
 
 optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
-    // Read Ethernet frame from the raw device
-    EthernetFrame frame;
     //  网卡读数据的! : _tap.read()
-    if (frame.parse(_tap.read()) != ParseResult::NoError) {
+    auto seg = _receive(_tap.read());
+
+    // The incoming frame may have caused the NetworkInterface to send a frame.
+    send_pending();
+    return seg;
+}
+
+optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::_receive(string &&raw_frame) {
+    // Parse the Ethernet frame read from the raw device
+    EthernetFrame frame;
+    if (frame.parse(move(raw_frame)) != ParseResult::NoError) {
         return {};
     }
 
     // Give the frame to the NetworkInterface. Get back an Internet datagram if frame was carrying one.
     optional<InternetDatagram> ip_dgram = _interface.recv_frame(frame);
 
-    // The incoming frame may have caused the NetworkInterface to send a frame.
-    send_pending();
-
     // Try to interpret IPv4 datagram as TCP
     if (ip_dgram) {
         return unwrap_tcp_in_ip(ip_dgram.value());
@@ -51,14 +58,41 @@ void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
     send_pending();
 }
 
+//! \details Drains up to FdAdapterConfig::max_batch frames from the TAP device (see TunTapFD::read_batch),
+//! then sends whatever the NetworkInterface queued in reply (e.g. ARP) in one batch.
+vector<TCPSegment> TCPOverIPv4OverEthernetAdapter::read_batch() {
+    vector<TCPSegment> segs;
+    for (auto &raw_frame : _tap.read_batch(max<size_t>(config().max_batch, 1))) {
+        if (auto seg = _receive(move(raw_frame))) {
+            segs.push_back(move(seg.value()));
+        }
+    }
+    send_pending();
+    return segs;
+}
+
+//! \param[in,out] segs the TCPSegments to send; empty on return
+void TCPOverIPv4OverEthernetAdapter::write_batch(queue<TCPSegment> &segs) {
+    while (not segs.empty()) {
+        _interface.send_datagram(wrap_tcp_in_ip(segs.front()), _next_hop);
+        segs.pop();
+    }
+    send_pending();
+}
+
 void TCPOverIPv4OverEthernetAdapter::send_pending() {
-    //  Frame逐个从TapFD发送出去
-        //  tap设备特点 : TAP device接收上层构造好的链路层帧(link-layer frames)并直接发送出去
+    //  tap设备特点 : TAP device接收上层构造好的链路层帧(link-layer frames)并直接发送出去, 一次write一个帧
+    //  所以攒起所有待发的帧, 由TunTapFD::write_batch一次提交 (每帧一个writev, 不拼接)
+    if (_interface.frames_out().empty()) {
+        return;
+    }
+    vector<BufferList> frames;
+    frames.reserve(_interface.frames_out().size());
     while (not _interface.frames_out().empty()) {
-        //  这个write最终还是从FileDescriptor封装的write发送出去
-        _tap.write(_interface.frames_out().front().serialize());
+        frames.push_back(_interface.frames_out().front().serialize());
         _interface.frames_out().pop();
     }
+    _tap.write_batch(frames, max<size_t>(config().max_batch, 1));
 }
 
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
@@ -6,8 +6,11 @@
 #include "tun.hh"
 
 #include <optional>
+#include <queue>
+#include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 #include <iostream>
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
@@ -33,6 +36,23 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
       _tun.write(wrap_tcp_in_ip(seg).serialize()); 
     }
 
+    //! A TUN device hands over one datagram per read(), so a batch is the result of a single read()
+    std::vector<TCPSegment> read_batch() {
+        std::vector<TCPSegment> segs;
+        if (auto seg = read()) {
+            segs.push_back(std::move(seg.value()));
+        }
+        return segs;
+    }
+
+    //! Writes every segment in `segs` (leaving it empty), one datagram per write()
+    void write_batch(std::queue<TCPSegment> &segs) {
+        while (not segs.empty()) {
+            write(segs.front());
+            segs.pop();
+        }
+    }
+
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
 
@@ -52,7 +72,10 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
 
     Address _next_hop;  //!< IP address of the next hop
 
-    void send_pending();  //!< Sends any pending Ethernet frames
+    void send_pending();  //!< Sends any pending Ethernet frames, together
+
+    //! Gives a frame read from the TAP device to the NetworkInterface; returns the TCP segment it carried, if any
+    std::optional<TCPSegment> _receive(std::string &&raw_frame);
 
   public:
     //! Construct from a TapFD
@@ -67,9 +90,18 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
     //  _interface
     void write(TCPSegment &seg);
 
+    //! Reads the frames that are waiting on the TAP device, up to FdAdapterConfig::max_batch, in one wakeup
+    std::vector<TCPSegment> read_batch();
+
+    //! Sends every segment in `segs` (leaving it empty)
+    void write_batch(std::queue<TCPSegment> &segs);
+
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
+    //! Milliseconds until the NetworkInterface's next ARP timeout
+    std::optional<size_t> next_timeout() const { return _interface.next_timeout(); }
+
     //! Access the underlying raw Ethernet connection
       //  trick : 重载引用 , 这样将TCPOverIPv4OverEthernetAdapter作为引用传递时 传递的就是最底层的TapFd
     operator TapFD &() { return _tap; }
@@ -1,5 +1,6 @@
 #include "tcp_receiver.hh"
 
+#include <algorithm>
 #include <iostream>
 
 using std::cout;
@@ -42,7 +43,35 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
 
     //  4.  push_substring(segment)
     //  这里可以看出 reassembler之中 payload占据空间 而不flag不占据空间
-    _reassembler.push_substring(string(seg.payload().str()), stream_idx, seg.header().fin);
+    //  直接把payload的Buffer交给reassembler, 不必拷贝成string
+    _reassembler.push_substring(seg.payload(), stream_idx, seg.header().fin);
+    if (seg.payload().size() > 0 && stream_idx > _reassembler.first_unassembled()) {
+        _last_out_of_order = stream_idx;
+    }
+}
+
+vector<SACKBlock> TCPReceiver::sack_blocks(const size_t max_blocks) const {
+    vector<SACKBlock> blocks;
+    if (listen()) {
+        return blocks;
+    }
+    //  stream idx -> seqno : 跳过syn占据的序号
+    const auto to_block = [&](const pair<uint64_t, uint64_t> &range) {
+        return SACKBlock{wrap(range.first + 1, _isn.value()), wrap(range.second + 1, _isn.value())};
+    };
+    const auto ranges = _reassembler.unassembled_ranges();
+    const auto latest = find_if(ranges.begin(), ranges.end(), [&](const auto &range) {
+        return _last_out_of_order && range.first <= *_last_out_of_order && *_last_out_of_order < range.second;
+    });
+    if (latest != ranges.end() && blocks.size() < max_blocks) {
+        blocks.push_back(to_block(*latest));
+    }
+    for (auto it = ranges.begin(); it != ranges.end() && blocks.size() < max_blocks; ++it) {
+        if (it != latest) {
+            blocks.push_back(to_block(*it));
+        }
+    }
+    return blocks;
 }
 
 optional<WrappingInt32> TCPReceiver::ackno() const {
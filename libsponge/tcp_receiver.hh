@@ -11,6 +11,7 @@ using std::cout;
 using std::endl;
 #include <cassert>
 #include <optional>
+#include <vector>
 
 //! \brief The "receiver" part of a TCP implementation.
 
@@ -24,6 +25,8 @@ class TCPReceiver {
     //! The maximum number of bytes we'll store.
     size_t _capacity;
     std::optional<WrappingInt32> _isn;
+    //  最近一个乱序到达的segment的stream idx, SACK的第一个block应当包含它 (RFC 2018)
+    std::optional<uint64_t> _last_out_of_order{};
 
     // State _state;
   private:
@@ -65,6 +68,11 @@ class TCPReceiver {
     //! accepted by the receiver) and (b) the sequence number of the
     //! beginning of the window (the ackno).
     size_t window_size() const;
+
+    //! \brief SACK blocks (RFC 2018) describing the out-of-order data held by the receiver
+    //! \details The block holding the most recently received segment comes first, the others follow in
+    //! sequence order. Empty if nothing arrived out of order.
+    std::vector<SACKBlock> sack_blocks(const size_t max_blocks = TCPOptions::MAX_SACK_BLOCKS) const;
     //!@}
 
     //! \brief number of bytes stored but not yet reassembled
@@ -48,15 +48,47 @@ TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const s
     , _receive_window_size(1)  //  >??
     , _initial_retransmission_timeout{retx_timeout}
     , _timer{}
+    , _rtt_estimation(false)
+    , _min_rto(TCPConfig::TIMEOUT_MIN)
+    , _max_rto(TCPConfig::TIMEOUT_MAX)
+    , _rto(retx_timeout)
     , _stream(capacity)
     , _consecutive_retransmissions_cnt(0) {}
 
-uint64_t TCPSender::bytes_in_flight() const {
-    uint64_t send_window_size = 0;
-    for (const auto &seg : _send_window) {
-        send_window_size += seg.length_in_sequence_space();
+TCPSender::TCPSender(const TCPConfig &config) : TCPSender(config.send_capacity, config.rt_timeout, config.fixed_isn) {
+    _rtt_estimation = config.rtt_estimation;
+    _min_rto = config.rt_timeout_min;
+    _max_rto = config.rt_timeout_max;
+    _mss = config.mss;
+    _mss_option = config.mss;
+    _congestion_control_algorithm = config.congestion_control;
+    _congestion_control = CongestionControl::make(_congestion_control_algorithm, _mss);
+    _sack = config.sack;
+    _fast_retransmit = config.fast_retransmit || config.sack;
+    if (config.window_scaling) {
+        _window_scale = config.window_shift();
     }
-    return send_window_size;
+    _nagle = config.nagle;
+}
+
+//  RFC 6298 (2.2) (2.3) (2.4) (2.5). G 取1ms, 即tick的粒度
+void TCPSender::rtt_sample(const uint64_t rtt) {
+    if (!_rtt_sampled) {
+        _srtt = rtt;
+        _rttvar = rtt / 2;
+        _rtt_sampled = true;
+    } else {
+        const uint64_t delta = _srtt > rtt ? _srtt - rtt : rtt - _srtt;
+        _rttvar = (3 * _rttvar + delta) / 4;
+        _srtt = (7 * _srtt + rtt) / 8;
+    }
+}
+
+uint64_t TCPSender::base_rto() const {
+    if (!_rtt_estimation || !_rtt_sampled) {
+        return _initial_retransmission_timeout;
+    }
+    return clamp(_srtt + max<uint64_t>(1, 4 * _rttvar), _min_rto, _max_rto);
 }
 
 size_t TCPSender::send_segment(size_t remaining_recv_window_sz) {
@@ -64,14 +96,27 @@ size_t TCPSender::send_segment(size_t remaining_recv_window_sz) {
     TCPSegment seg;
     seg.header().seqno = next_seqno();
     //  syn
-    if (state() == State::CLOSED && remaining_recv_window_sz >= 1)
+    if (state() == State::CLOSED && remaining_recv_window_sz >= 1) {
         seg.header().syn = true;
+        seg.header().options.mss = _mss_option;
+        seg.header().options.sack_permitted = _sack;
+        seg.header().options.window_scale = _window_scale;
+        seg.header().update_doff();
+    }
+
+    //  Nagle (RFC 896): 还有未确认的数据时, 不足一个MSS的数据先攒着, 等ack回来或攒满一个MSS. FIN不必等
+    if (_nagle && !seg.header().syn && bytes_in_flight() > 0 && _stream.buffer_size() < _mss &&
+        !_stream.input_ended()) {
+        return 0;
+    }
 
     //  payload
     size_t payload_sz =
-        min({TCPConfig::MAX_PAYLOAD_SIZE, remaining_recv_window_sz - seg.header().syn, _stream.buffer_size()});
-    seg.payload() =
-        _stream.read(payload_sz);  //  bytestream中读取出来的是tcp payload。至于tcp header 是由sender自己填写。
+        min({_mss, remaining_recv_window_sz - seg.header().syn, _stream.buffer_size()});
+    //  bytestream中读取出来的是tcp payload。至于tcp header 是由sender自己填写。
+    //  payload落在一次write的范围内时, 直接共享该write的storage, 不必拷贝; 跨越多次write时才拼接一次
+    const BufferList payload = _stream.read_buffers(payload_sz);
+    seg.payload() = payload.buffers().size() <= 1 ? Buffer(payload) : Buffer(payload.concatenate());
 
     //  fin
     if (state() == SYN_ACKED_2 && remaining_recv_window_sz > payload_sz + seg.header().syn)
@@ -81,6 +126,10 @@ size_t TCPSender::send_segment(size_t remaining_recv_window_sz) {
     if (seg.length_in_sequence_space() != 0) {
         _segments_out.push(seg);
         _send_window.push_back(seg);
+        _bytes_in_flight += seg.length_in_sequence_space();
+        if (_rtt_estimation && !_rtt_probe) {
+            _rtt_probe = {_next_seqno + seg.length_in_sequence_space(), _time_ms};
+        }
     }
 
     //  3.  return length in seq space
@@ -94,7 +143,7 @@ size_t TCPSender::send_segment(size_t remaining_recv_window_sz) {
 void TCPSender::timer_when_filling() {
     if (!_timer.active()) {
         _timer.reset();
-        _timer.start(_initial_retransmission_timeout);
+        _timer.start(_rto);
     }
 }
 
@@ -108,11 +157,12 @@ void TCPSender::update_when_filling(size_t seg_len_in_seq_space, size_t &remaini
 void TCPSender::fill_window()  //  try to send segment to fill the receive window
 {
     size_t remaining_recv_window_sz = _receive_window_size == 0 ? 1 : _receive_window_size;
-    if (bytes_in_flight() > remaining_recv_window_sz) {
-        // "the recv_window should == bytes_in_flight"
-        // "In fact , the receive_window is full now , but because of our sender implementation , we can't acked part of
-        // the segment , so we can't bascially remaining_recv_window_sz -= bytes_in_flight() to get 0 . Instead, we
-        // should return now"
+    //  有拥塞控制时, 发送窗口 = min(rwnd, cwnd)
+    if (_congestion_control) {
+        remaining_recv_window_sz = min(remaining_recv_window_sz, _congestion_control->cwnd());
+    }
+    //  部分被ack的seg会在ack_received中被裁剪, 所以bytes_in_flight()就是窗口中精确的未确认字节数
+    if (bytes_in_flight() >= remaining_recv_window_sz) {
         return;
     }
 
@@ -136,10 +186,24 @@ void TCPSender::fill_window()  //  try to send segment to fill the receive windo
     }
 }
 
+//  RFC 9293 (3.7.1): 发送的segment不能超过peer通告的MSS. 过小的MSS会让每字节的开销暴增, 故设下限
+void TCPSender::set_peer_mss(const uint16_t peer_mss) {
+    //  已经发送过数据 (如收到重复的SYN) : 不再改变MSS和拥塞窗口
+    if (_next_seqno > 1) {
+        return;
+    }
+    _mss = min<size_t>(_mss, max(peer_mss, TCPConfig::MIN_MSS));
+    _congestion_control = CongestionControl::make(_congestion_control_algorithm, _mss);
+}
+
 //! \param ackno The remote receiver's ackno (acknowledgment number)
 //! \param window_size The remote receiver's advertised window size
 //  robust enough to deal with any ackno
-void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size) {
+void TCPSender::ack_received(const WrappingInt32 ackno,
+                             const size_t window_size,
+                             const bool carries_data,
+                             const vector<SACKBlock> &sack) {
+    const size_t previous_window_size = _receive_window_size;
     _receive_window_size = window_size;
 
     uint64_t abs_ackno = unwrap(ackno, _isn, _next_seqno);
@@ -153,40 +217,79 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
     if (_send_window.empty())
         return;
 
+    const uint64_t bytes_in_flight_before = _bytes_in_flight;
     bool seg_acked = false;  //  whether the seg in send_window is acked。(可以顺带排除ack < left edge of the send_window)
-    //  remove acked seg from the send_window
-    for (deque<TCPSegment>::iterator iter = _send_window.begin(); iter != _send_window.end();) {
-        uint64_t abs_idx = unwrap(iter->header().seqno, _isn, _next_seqno);
-        uint64_t len = iter->length_in_sequence_space();
-        //  _send_window中得seqno一定都是增序排列(由fill_window可知，是按照发送的顺序push到send_window中的)
+    //  remove acked seg from the front of the send_window
+    //  _send_window中的seg按seqno增序且首尾相接, 故不必逐个unwrap: 队首的abs seqno就是左边界
+    while (!_send_window.empty()) {
+        const uint64_t abs_idx = _next_seqno - _bytes_in_flight;
+        const uint64_t len = _send_window.front().length_in_sequence_space();
         if (abs_idx >= abs_ackno)
             break;
-        //  remove seg from send_window
-        if (abs_idx + len <= abs_ackno)  
-        {
-            seg_acked = true;
-            iter = _send_window.erase(iter);
-        } else {
-        //  not remove seg from send_window
-            ++iter;
+        seg_acked = true;
+        if (abs_idx + len > abs_ackno) {
+            //  部分被ack : 原地裁掉已确认的前缀, 重传时只发送未确认的字节
+            trim_front(abs_ackno - abs_idx);
+            break;
         }
+        _bytes_in_flight -= len;
+        _send_window.pop_front();
+    }
+    if (_sack) {
+        update_scoreboard(sack);
     }
 
     //  send_window中没有字节被ack，故不需要重启 / 关闭定时器 ，也不需要发送数据
     if (!seg_acked) {
+        //  RFC 5681 (2) duplicate ack : 有未确认的数据, 不携带数据, ackno为窗口左边界, 且通告窗口不变
+        if (_fast_retransmit && !carries_data && abs_ackno == _next_seqno - _bytes_in_flight &&
+            window_size == previous_window_size) {
+            dup_ack_received();
+        }
         fill_window();
         return;
     }
     
     //  上一个计时重传的分组被移除 故 下一个重新计数
     _consecutive_retransmissions_cnt = 0;
+    _dup_acks = 0;
+
+    //  计时的seg被ack了 : 得到一个RTT样本
+    if (_rtt_probe && abs_ackno >= _rtt_probe->first) {
+        rtt_sample(_time_ms - _rtt_probe->second);
+        _rtt_probe.reset();
+    }
+    //  新数据被ack : 撤销退避 (backoff reset)
+    _rto = base_rto();
+
+    const size_t acked = bytes_in_flight_before - _bytes_in_flight;
+    if (_recover && abs_ackno < *_recover) {
+        //  NewReno partial ack : 恢复开始时在途的数据中还有丢失, 立即重传下一个空洞, 仍处于recovery
+        //  有SACK信息时只重传scoreboard上判定丢失的空洞
+        if (_congestion_control) {
+            _congestion_control->on_partial_ack(acked);
+        }
+        if (_sacked.empty()) {
+            retransmit_front();
+        } else {
+            retransmit_holes();
+        }
+    } else if (_recover) {
+        //  full ack : 退出fast recovery
+        _recover.reset();
+        if (_congestion_control) {
+            _congestion_control->on_recovery_exit();
+        }
+    } else if (_congestion_control) {
+        _congestion_control->on_ack(acked, _time_ms, _srtt);
+    }
 
     //    (5.3) When an ACK is received that acknowledges new data, restart the
     //      retransmission timer so that it will expire after RTO seconds
     //      (for the current value of RTO).
     if (!_send_window.empty()) {
         _timer.reset();
-        _timer.start(_initial_retransmission_timeout);
+        _timer.start(_rto);
     }
     //    (5.2) When all outstanding data has been acknowledged, turn off the retransmission timer. 即 send_window is empty , close the timer
     else {
@@ -197,24 +300,141 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
     fill_window();
 }
 
+//  从队首seg的seq空间中去掉前n个序号 (SYN占第一个, 之后是payload; FIN在最后, 不会被部分ack)
+void TCPSender::trim_front(uint64_t n) {
+    TCPSegment &seg = _send_window.front();
+    _bytes_in_flight -= n;
+    seg.header().seqno = seg.header().seqno + static_cast<uint32_t>(n);
+    if (seg.header().syn) {
+        seg.header().syn = false;
+        --n;
+    }
+    seg.payload().remove_prefix(n);
+}
+
+void TCPSender::dup_ack_received() {
+    ++_dup_acks;
+    //  RFC 5681 (3.2) 步骤4: recovery期间每个dup ack说明又有一个seg离开了网络, 膨胀cwnd以发送新数据
+    //  dup ack带来的SACK信息可能揭示新的丢失
+    if (_recover) {
+        if (_congestion_control) {
+            _congestion_control->on_dup_ack();
+        }
+        retransmit_holes();
+        return;
+    }
+    if (_dup_acks != DUP_ACK_THRESHOLD) {
+        return;
+    }
+    //  第三个dup ack : 不等RTO, 立即重传最早的未确认seg并进入fast recovery
+    _recover = _next_seqno;
+    if (_congestion_control) {
+        _congestion_control->on_fast_retransmit(_bytes_in_flight);
+    }
+    _high_rxt = 0;
+    retransmit_front();
+    retransmit_holes();
+}
+
+void TCPSender::retransmit_front() {
+    //  Karn : 被重传的seg的ack无法区分是对哪次发送的确认, 不能作为RTT样本
+    _rtt_probe.reset();
+    _segments_out.push(_send_window.front());
+    _high_rxt = max(_high_rxt, _next_seqno - _bytes_in_flight + _send_window.front().length_in_sequence_space());
+}
+
+//  只接受落在 [左边界, _next_seqno) 之内的block, 与已有的范围合并
+void TCPSender::update_scoreboard(const vector<SACKBlock> &sack) {
+    const uint64_t left_edge = _next_seqno - _bytes_in_flight;
+    while (!_sacked.empty() && _sacked.begin()->first < left_edge) {
+        const auto [first, second] = *_sacked.begin();
+        _sacked.erase(_sacked.begin());
+        if (second > left_edge) {
+            _sacked.emplace(left_edge, second);
+            break;
+        }
+    }
+    for (const SACKBlock &block : sack) {
+        uint64_t first = unwrap(block.left, _isn, _next_seqno);
+        uint64_t second = first + static_cast<uint32_t>(block.right - block.left);
+        if (first < left_edge || second > _next_seqno || first >= second) {
+            continue;
+        }
+        auto it = _sacked.upper_bound(first);
+        if (it != _sacked.begin() && prev(it)->second >= first) {
+            --it;
+        }
+        while (it != _sacked.end() && it->first <= second) {
+            first = min(first, it->first);
+            second = max(second, it->second);
+            it = _sacked.erase(it);
+        }
+        _sacked.emplace(first, second);
+    }
+}
+
+//  RFC 6675 IsLost : 其后被SACK的字节超过 (DupThresh - 1) * SMSS 的空洞视为丢失. 每个空洞在一次recovery中只重传一次
+void TCPSender::retransmit_holes() {
+    size_t sacked_above = bytes_sacked();
+    auto range = _sacked.begin();
+    uint64_t start = _next_seqno - _bytes_in_flight;
+    for (const TCPSegment &seg : _send_window) {
+        const uint64_t end = start + seg.length_in_sequence_space();
+        bool sacked = false;
+        while (range != _sacked.end() && range->first < end) {
+            sacked = sacked || (range->first <= start && range->second >= end);
+            if (range->second > end) {
+                break;
+            }
+            sacked_above -= range->second - range->first;
+            ++range;
+        }
+        if (sacked_above <= (DUP_ACK_THRESHOLD - 1) * _mss) {
+            break;
+        }
+        if (!sacked && start >= _high_rxt) {
+            _rtt_probe.reset();
+            _segments_out.push(seg);
+            _high_rxt = end;
+        }
+        start = end;
+    }
+}
+
+size_t TCPSender::bytes_sacked() const {
+    size_t n = 0;
+    for (const auto &[first, second] : _sacked) {
+        n += second - first;
+    }
+    return n;
+}
+
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPSender::tick(const size_t ms_since_last_tick) {
+    _time_ms += ms_since_last_tick;
+
     // timer not active but want to use
     if (!_timer.active())  //  send_extra.cc 最后在alarm不工作的时候又调用了一次tick
         return;
 
     //    When the retransmission timer expires, do the following: 5.4 , 5.5 , 5.6 , 5.7
     if (_timer.elapse(ms_since_last_tick)) {
-        TCPSegment &oldest_seg = _send_window.front();
-
-        uint64_t timeout = _timer.initial_alarm();
         //  (why ?) only when window size > 0 , double alarm and ++ cnt
         if (_receive_window_size > 0) {
             //    (5.5) The host MUST set RTO <- RTO * 2 ("back off the timer").  The
             //          maximum value discussed in (2.5) above may be used to provide
             //          an upper bound to this doubling operation.
-            timeout <<= 1;
+            _rto = _rtt_estimation ? min(_rto * 2, _max_rto) : _rto * 2;
             ++_consecutive_retransmissions_cnt;  
+            //  超时即拥塞的信号 : 乘性减 (RFC 5681 (4))
+            if (_congestion_control) {
+                _congestion_control->on_timeout(_bytes_in_flight);
+            }
+            //  超时后从slow start重新开始, 放弃当前的fast recovery
+            //  peer可能丢弃了已SACK的数据 (reneging), 故scoreboard也不再可信 (RFC 2018 (8))
+            _dup_acks = 0;
+            _recover.reset();
+            _sacked.clear();
             //    (5.7) If the timer expires awaiting the ACK of a SYN segment and the
             //          TCP implementation is using an RTO less than 3 seconds, the RTO
             //          MUST be re-initialized to 3 seconds when data transmission
@@ -224,10 +444,10 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
         //  seconds (for the value of RTO after the doubling operation
         //  outlined in 5.5).
         _timer.reset();
-        _timer.start(timeout);
+        _timer.start(_rto);
 
         //  (5.4) Retransmit the earliest segment that has not been acknowledged by the TCP receiver.
-        _segments_out.push(oldest_seg);     //  即 超时重传
+        retransmit_front();     //  即 超时重传
     }
 }
 
@@ -2,15 +2,21 @@
 #define SPONGE_LIBSPONGE_TCP_SENDER_HH
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <deque>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
 #include <queue>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 using std::cout;
@@ -65,6 +71,10 @@ class TCPSender {
     //  由于我们fill_window的顺序 也即push的顺序 故里面的seg也都是按照seqno增序排序的
     deque<TCPSegment> _send_window;
 
+    //  _send_window中所有seg的length_in_sequence_space之和. 发送时加, 被ack时减, 使bytes_in_flight()为O(1)
+    //  由于_send_window按seqno增序且连续, 其左边界的abs seqno就是 _next_seqno - _bytes_in_flight
+    uint64_t _bytes_in_flight{0};
+
     // size_t _send_window_size;     //  就是 size_t outstanding_bytes; 就是已经发送
     // 但是未确认的字节数量（占据seq空间）。就是_segment_out payload + SYN + FIN
     //  我不理解 为什么send_window的初始值是1
@@ -77,6 +87,49 @@ class TCPSender {
     // retransmission timer for the left edge of the sending window
     Timer _timer;
 
+    //! \name RTT estimation (RFC 6298), only used when `_rtt_estimation` is set
+    //!@{
+    bool _rtt_estimation;
+    uint64_t _min_rto;
+    uint64_t _max_rto;
+    uint64_t _rto;               //!< current retransmission timeout, including backoff
+    uint64_t _srtt{0};           //!< smoothed RTT, valid once `_rtt_sampled`
+    uint64_t _rttvar{0};         //!< RTT variation
+    bool _rtt_sampled{false};
+    uint64_t _time_ms{0};        //!< milliseconds ticked since construction
+    //  每次只对一个seg计时: <该seg之后的abs seqno, 发送时刻>. 该seg被重传后就不再计时 (Karn)
+    std::optional<std::pair<uint64_t, uint64_t>> _rtt_probe{};
+    //!@}
+
+    //! largest payload to send: our configured MSS, lowered by the peer's MSS option
+    size_t _mss{TCPConfig::MAX_PAYLOAD_SIZE};
+    //! MSS option offered in our SYN, if any
+    std::optional<uint16_t> _mss_option{};
+
+    //! congestion window policy, nullptr if only the receiver's window limits us
+    std::unique_ptr<CongestionControl> _congestion_control{};
+    CongestionControlAlgorithm _congestion_control_algorithm{CongestionControlAlgorithm::None};
+
+    //! \name Fast retransmit and fast recovery (RFC 5681 (3.2), RFC 6582), only used when `_fast_retransmit` is set
+    //!@{
+    bool _fast_retransmit{false};
+    unsigned _dup_acks{0};               //!< duplicate ACKs since the left edge of the window last moved
+    std::optional<uint64_t> _recover{};  //!< in fast recovery: `_next_seqno` when it began
+    //!@}
+
+    //! \name SACK scoreboard (RFC 2018, RFC 6675), only used when `_sack` is set
+    //!@{
+    bool _sack{false};
+    std::map<uint64_t, uint64_t> _sacked{};  //!< abs seqno ranges [first, second) the peer holds beyond the ackno
+    uint64_t _high_rxt{0};                   //!< abs seqno up to which segments were retransmitted in this recovery
+    //!@}
+
+    //! window scale shift offered in our SYN (RFC 7323), if any
+    std::optional<uint8_t> _window_scale{};
+
+    //! Nagle's algorithm (RFC 896): don't send a sub-MSS segment while data is unacknowledged
+    bool _nagle{false};
+
     //! outgoing stream of bytes that have not yet been sent
     ByteStream _stream;
 
@@ -100,9 +153,24 @@ class TCPSender {
         return stream_in().eof() && next_seqno_absolute() == stream_in().bytes_written() + 2 && bytes_in_flight() == 0;
     }
 
+    //! Fold one RTT sample into SRTT/RTTVAR and recompute the RTO
+    void rtt_sample(uint64_t rtt);
+    //! RTO to use when the backoff is reset: the estimate, or the initial RTO before any sample
+    uint64_t base_rto() const;
+
     size_t send_segment(size_t remaining_recv_window_sz);
     void timer_when_filling();
     void update_when_filling(size_t seg_len_in_seq_space, size_t &remaining_recv_window_sz);
+    //! Drop the first `n` (acknowledged) sequence numbers of the oldest outstanding segment
+    void trim_front(uint64_t n);
+    //! Count a duplicate ACK, fast retransmitting on the third one
+    void dup_ack_received();
+    //! Send the oldest outstanding segment again
+    void retransmit_front();
+    //! Record the peer's SACK blocks on the scoreboard, dropping what the ackno already covers
+    void update_scoreboard(const std::vector<SACKBlock> &sack);
+    //! Retransmit every segment the scoreboard shows as lost and not yet retransmitted in this recovery
+    void retransmit_holes();
 
   public:
     //  原先以为：接收方回复的ack是累计确认，那么sender要发送的下一个字节的序号自然就是ack。那么_next_seq就是ack。不过很可惜，似乎想错了，_next_seq并非ack。
@@ -139,11 +207,17 @@ class TCPSender {
     }
 
   public:
+    //! Duplicate ACKs that signal a lost segment
+    static constexpr unsigned DUP_ACK_THRESHOLD = 3;
+
     //! Initialize a TCPSender
     TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
               const std::optional<WrappingInt32> fixed_isn = {});
 
+    //! Initialize a TCPSender from the sender-side settings of a TCPConfig
+    explicit TCPSender(const TCPConfig &config);
+
     //! \name "Input" interface for the writer
     //!@{
     ByteStream &stream_in() { return _stream; }
@@ -154,7 +228,14 @@ class TCPSender {
     //!@{
 
     //! \brief A new acknowledgment was received
-    void ack_received(const WrappingInt32 ackno, const uint16_t window_size);
+    //! \param window_size the peer's window in bytes, i.e., already scaled by its window scale shift
+    //! \param carries_data whether the segment holding the ACK occupied sequence numbers,
+    //! in which case it does not count as a duplicate ACK
+    //! \param sack the SACK blocks of the segment holding the ACK
+    void ack_received(const WrappingInt32 ackno,
+                      const size_t window_size,
+                      const bool carries_data = false,
+                      const std::vector<SACKBlock> &sack = {});
 
     //! \brief Generate an empty-payload segment (useful for creating empty ACK segments)
     //  empty : empty-payload or len_in_seq = 0 ? 我目前认为是后者
@@ -165,6 +246,10 @@ class TCPSender {
     //! \brief create and send segments to fill as much of the window as possible
     void fill_window();
 
+    //! \brief The peer's SYN offered MSS `peer_mss`: never send larger payloads
+    //! \note It restarts the congestion window with the new MSS, so it is ignored once data was sent
+    void set_peer_mss(const uint16_t peer_mss);
+
     //! \brief Notifies the TCPSender of the passage of time
     void tick(const size_t ms_since_last_tick);
     //!@}
@@ -179,12 +264,40 @@ class TCPSender {
     //  就是outstanding_bytes的数量
     // count is in "sequence space,
     // _send_window_size
-    size_t bytes_in_flight() const;
+    size_t bytes_in_flight() const { return _bytes_in_flight; }
 
     //! \brief Number of consecutive retransmissions that have occurred in a row
     //  对于同一分组的 重传次数（目前我认为是这样的）
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief Smoothed round-trip time in milliseconds (0 until the first sample)
+    uint64_t srtt() const { return _srtt; }
+
+    //! \brief Current retransmission timeout in milliseconds, including any backoff
+    uint64_t rto() const { return _rto; }
+
+    //! \brief Milliseconds of tick() until the retransmission timer expires, if it is running
+    std::optional<uint64_t> next_timeout() const {
+        return _timer.active() ? std::optional<uint64_t>{_timer.alarm()} : std::nullopt;
+    }
+
+    //! \brief Turn Nagle's algorithm on or off (off is TCP_NODELAY); call fill_window() to send what it held back
+    void set_nagle(const bool nagle) { _nagle = nagle; }
+
+    //! \brief Largest payload the sender puts in a segment
+    size_t mss() const { return _mss; }
+
+    //! \brief Whether the sender is in fast recovery
+    bool in_fast_recovery() const { return _recover.has_value(); }
+
+    //! \brief Bytes (in sequence space) beyond the ackno that the peer reported holding with SACK
+    size_t bytes_sacked() const;
+
+    //! \brief Congestion window in bytes, or nullopt without congestion control
+    std::optional<size_t> cwnd() const {
+        return _congestion_control ? std::optional<size_t>{_congestion_control->cwnd()} : std::nullopt;
+    }
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
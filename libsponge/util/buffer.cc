@@ -7,7 +7,17 @@ void Buffer::remove_prefix(const size_t n) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
+    if (_storage and _starting_offset + _suffix_removed == _storage->size()) {
+        _storage.reset();
+    }
+}
+
+void Buffer::remove_suffix(const size_t n) {
+    if (n > str().size()) {
+        throw out_of_range("Buffer::remove_suffix");
+    }
+    _suffix_removed += n;
+    if (_storage and _starting_offset + _suffix_removed == _storage->size()) {
         _storage.reset();
     }
 }
@@ -18,6 +28,12 @@ void BufferList::append(const BufferList &other) {
     }
 }
 
+void BufferList::prepend(const BufferList &other) {
+    for (auto it = other._buffers.rbegin(); it != other._buffers.rend(); ++it) {
+        _buffers.push_front(*it);
+    }
+}
+
 BufferList::operator Buffer() const {
     switch (_buffers.size()) {
         case 0:
@@ -70,6 +86,12 @@ BufferViewList::BufferViewList(const BufferList &buffers) {
     }
 }
 
+void BufferViewList::append(std::string_view str) {
+    if (not str.empty()) {
+        _views.push_back(str);
+    }
+}
+
 void BufferViewList::remove_prefix(size_t n) {
     while (n > 0) {
         if (_views.empty()) {
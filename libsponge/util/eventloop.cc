@@ -2,7 +2,13 @@
 
 #include "util.hh"
 
+#ifdef HAVE_IO_URING
+#include "io_uring.hh"
+#endif
+
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <stdexcept>
 #include <system_error>
 #include <utility>
@@ -15,22 +21,199 @@ unsigned int EventLoop::Rule::service_count() const {
     return direction == Direction::In ? fd.read_count() : fd.write_count();
 }
 
+//  io_uring的SQ大小. 一次wait要(重新)arm的poll超过这个数时, next_sqe会先提交一部分
+static constexpr unsigned IO_URING_ENTRIES = 256;
+
+EventLoop::EventLoop(const Backend backend) : _backend(backend) {
+    if (_backend == Backend::Epoll) {
+        _epoll.emplace(SystemCall("epoll_create1", ::epoll_create1(EPOLL_CLOEXEC)));
+    } else if (_backend == Backend::IoUring) {
+#ifdef HAVE_IO_URING
+        _ring = make_unique<IoUring>(IO_URING_ENTRIES);
+#else
+        throw runtime_error("EventLoop: Backend::IoUring is not supported (built without Linux 5.17 io_uring headers)");
+#endif
+    }
+}
+
+//  IoUring在这里才是完整类型
+EventLoop::~EventLoop() = default;
+EventLoop::EventLoop(EventLoop &&other) = default;
+EventLoop &EventLoop::operator=(EventLoop &&other) = default;
+
 //! \param[in] fd is the FileDescriptor to be polled
 //! \param[in] direction indicates whether to poll for reading (Direction::In) or writing (Direction::Out)
 //! \param[in] callback is called when `fd` is ready.
 //! \param[in] interest is called by EventLoop::wait_next_event. If it returns `true`, `fd` will
 //!                     be polled, otherwise `fd` will be ignored only for this execution of `wait_next_event.
+//!                     If empty, `fd` is always polled.
 //! \param[in] cancel is called when the rule is cancelled (e.g. on hangup, EOF, or closure).
 void EventLoop::add_rule(const FileDescriptor &fd,
                          const Direction direction,
                          const CallbackT &callback,
                          const InterestT &interest,
                          const CallbackT &cancel) {
-    _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
+    if (_backend == Backend::Poll) {
+        _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
+        return;
+    }
+
+    //  epoll/io_uring: 没有interest回调的rule永远感兴趣, 不必每次wait都访问它
+    RuleList &rules = interest ? _rules : _always_interested;
+    const auto it = rules.insert(rules.end(), {fd.duplicate(), direction, callback, interest, cancel});
+    if (_backend == Backend::IoUring) {
+        if (not interest) {
+            arm(it);
+        }
+        return;
+    }
+
+    const auto [registration, inserted] = _registrations.try_emplace(it->fd.fd_num());
+    registration->second.rules.push_back(it);
+    //  先以空事件注册, 这样即使没有感兴趣的方向也能收到错误.
+    //  已有注册时ADD返回EEXIST; 但若旧fd已关闭而fd号被复用, 内核里已经没有注册了, 这里重新注册
+    epoll_event ev{};
+    ev.data.fd = it->fd.fd_num();
+    const int added = ::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_ADD, ev.data.fd, &ev);
+    if (SystemCall("epoll_ctl", added, inserted ? 0 : EEXIST) == 0) {
+        registration->second.events = 0;
+        _dirty.push_back(ev.data.fd);
+    }
+    if (not interest) {
+        set_interest(*it, true);
+    }
 }
 
-//! \param[in] timeout_ms is the timeout value passed to [poll(2)](\ref man2::poll); `wait_next_event`
-//!                       returns Result::Timeout if no fd is ready after the timeout expires.
+void EventLoop::set_interest(Rule &rule, const bool interested) {
+    if (rule.registered == interested) {
+        return;
+    }
+    rule.registered = interested;
+    _interested += interested ? 1 : -1;
+    _dirty.push_back(rule.fd.fd_num());
+}
+
+void EventLoop::update_registrations() {
+    for (const int fd_num : _dirty) {
+        const auto registration = _registrations.find(fd_num);
+        if (registration == _registrations.end()) {
+            continue;  //  该fd的rule都已经取消
+        }
+        uint32_t events = 0;
+        for (const auto &rule : registration->second.rules) {
+            if (rule->registered) {
+                events |= static_cast<uint16_t>(rule->direction);
+            }
+        }
+        if (events == registration->second.events) {
+            continue;
+        }
+        registration->second.events = events;
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd_num;
+        //  fd被关闭后内核会自动删除注册, 同一个fd号可能又被复用了: 这时重新ADD
+        if (::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_MOD, fd_num, &ev) < 0 and errno == ENOENT) {
+            SystemCall("epoll_ctl", ::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_ADD, fd_num, &ev));
+        }
+    }
+    _dirty.clear();
+}
+
+#ifdef HAVE_IO_URING
+void EventLoop::arm(const RuleList::iterator rule) {
+    io_uring_sqe &sqe = _ring->next_sqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = rule->fd.fd_num();
+    sqe.poll32_events = static_cast<uint16_t>(rule->direction);
+    sqe.user_data = rule->armed_poll = _next_poll++;
+    _armed.emplace(rule->armed_poll, rule);
+    ++_interested;
+}
+
+void EventLoop::disarm(Rule &rule) {
+    if (rule.armed_poll == 0) {
+        return;
+    }
+    io_uring_sqe &sqe = _ring->next_sqe();
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.addr = rule.armed_poll;
+    sqe.flags = IOSQE_CQE_SKIP_SUCCESS;  //  成功的remove不产生completion; 失败的user_data为0, 被忽略
+    _armed.erase(rule.armed_poll);
+    rule.armed_poll = 0;
+    --_interested;
+}
+#else
+//  没有io_uring时构造函数不会让Backend::IoUring的EventLoop存在, 这些都调用不到
+void EventLoop::arm(const RuleList::iterator) {}
+void EventLoop::disarm(Rule &) {}
+#endif
+
+EventLoop::RuleList::iterator EventLoop::cancel_rule(const RuleList::iterator rule) {
+    rule->cancel();
+
+    if (_backend == Backend::IoUring) {
+        disarm(*rule);
+    } else {
+        set_interest(*rule, false);
+
+        const int fd_num = rule->fd.fd_num();
+        auto &rules = _registrations.at(fd_num).rules;
+        rules.erase(find(rules.begin(), rules.end(), rule));
+        if (rules.empty()) {
+            //  fd可能已经关闭 (内核已删除注册), 忽略错误
+            ::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_DEL, fd_num, nullptr);
+            _registrations.erase(fd_num);
+        }
+    }
+
+    return (rule->interest ? _rules : _always_interested).erase(rule);
+}
+
+//! \param[in] delay_ms is how long from now the timer fires, in milliseconds
+//! \param[in] callback is called by EventLoop::wait_next_event once the delay has passed
+//! \returns an id that can be passed to EventLoop::cancel_timer
+EventLoop::TimerId EventLoop::add_timer(const uint64_t delay_ms, const CallbackT &callback) {
+    const TimerId timer = _next_timer++;
+    const uint64_t deadline = timestamp_ms() + delay_ms;
+    _timer_queue.emplace(deadline, timer);
+    _timers.emplace(timer, make_pair(deadline, callback));
+    return timer;
+}
+
+void EventLoop::cancel_timer(const TimerId timer) {
+    const auto it = _timers.find(timer);
+    if (it == _timers.end()) {
+        return;
+    }
+    _timer_queue.erase({it->second.first, timer});
+    _timers.erase(it);
+}
+
+bool EventLoop::run_timers() {
+    //  先收集到期的: callback里可能add_timer/cancel_timer, 新加的定时器留到下一次
+    vector<TimerId> due{};
+    const uint64_t now = timestamp_ms();
+    for (auto it = _timer_queue.begin(); it != _timer_queue.end() && it->first <= now; ++it) {
+        due.push_back(it->second);
+    }
+    bool fired = false;
+    for (const TimerId timer : due) {
+        const auto it = _timers.find(timer);
+        if (it == _timers.end()) {
+            continue;  //  被前面的callback取消了
+        }
+        const CallbackT callback = move(it->second.second);
+        cancel_timer(timer);
+        callback();
+        fired = true;
+    }
+    return fired;
+}
+
+//! \param[in] timeout_ms is the timeout value passed to [poll(2)](\ref man2::poll), or -1 to wait indefinitely;
+//!                       the earliest pending timer shortens it. `wait_next_event` returns Result::Timeout if
+//!                       no fd is ready and no timer fired before the timeout expires.
 //! \returns Eventloop::Result indicating success, timeout, or no more Rule objects to poll.
 //!
 //! For each Rule, this function first calls Rule::interest; if `true`, Rule::fd is added to the
@@ -53,14 +236,60 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //!
 //! Otherwise, this function returns Result::Success.
 //!
+//! Timers that are due are run after the ready rules' callbacks. While a timer is pending,
+//! this function sleeps until it is due rather than returning Result::Exit.
+//!
 //! \b IMPORTANT: every call to Rule::callback must read from or write to Rule::fd, or the `interest`
 //! callback must stop returning true after the callback completes.
 //! If none of these conditions occur, EventLoop::wait_next_event will throw std::runtime_error. This is
 //! because [poll(2)](\ref man2::poll) is level triggered, so failing to act on a ready file descriptor
 //! will result in a busy loop (poll returns on a ready file descriptor; file descriptor is not read or
 //! written, so it is still ready; the next call to poll will immediately return).
-//  1. make pollfds  2. poll() 监听事件  3. handleEvents
+//!
+//! With Backend::Epoll and Backend::IoUring the same rules apply, except that a Rule without an interest
+//! callback is not visited unless its fd is ready, so it is canceled on EOF or closure only after its callback runs.
 EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
+    //  最早的定时器决定最多睡多久
+    int wait_ms = timeout_ms;
+    if (not _timer_queue.empty()) {
+        const uint64_t now = timestamp_ms();
+        const uint64_t deadline = _timer_queue.begin()->first;
+        const int until_deadline = deadline > now ? static_cast<int>(min<uint64_t>(deadline - now, INT_MAX)) : 0;
+        wait_ms = timeout_ms < 0 ? until_deadline : min(timeout_ms, until_deadline);
+    }
+
+    _interrupted = false;
+    Result result = Result::Exit;
+    switch (_backend) {
+        case Backend::Epoll:
+            result = wait_epoll(wait_ms);
+            break;
+        case Backend::IoUring:
+            result = wait_io_uring(wait_ms);
+            break;
+        default:
+            result = wait_poll(wait_ms);
+    }
+
+    if (result == Result::Exit) {
+        if (_interrupted or _timer_queue.empty()) {
+            return Result::Exit;
+        }
+        //  没有fd可等, 但还有定时器: 睡到它到期
+        if (wait_ms > 0 && ::poll(nullptr, 0, wait_ms) < 0 && errno == EINTR) {
+            return Result::Exit;
+        }
+        result = Result::Timeout;
+    }
+
+    if (run_timers() && result == Result::Timeout) {
+        result = Result::Success;
+    }
+    return result;
+}
+
+//  1. make pollfds  2. poll() 监听事件  3. handleEvents
+EventLoop::Result EventLoop::wait_poll(const int timeout_ms) {
     vector<pollfd> pollfds{};
     pollfds.reserve(_rules.size());
     bool something_to_poll = false;
@@ -84,7 +313,7 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
             continue;
         }
         //  如果该事件需要被poll
-        if (this_rule.interest()) {
+        if (this_rule.interested()) {
             pollfds.push_back({this_rule.fd.fd_num(), static_cast<short>(this_rule.direction), 0});
             something_to_poll = true;
         } else {
@@ -108,13 +337,14 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
     } catch (unix_error const &e) {
         //  发生异常 / 事件不应被监听 return Exit
         if (e.code().value() == EINTR) {
+            _interrupted = true;
             return Result::Exit;
         }
     }
 
     // go through the poll results
-    //  遍历 , 处理活跃事件
-    for (auto [it, idx] = make_pair(_rules.begin(), size_t(0)); it != _rules.end(); ++idx) {
+    //  遍历 , 处理活跃事件. 回调里新加的rule排在末尾, 没有对应的pollfd, 下一次才poll它们
+    for (auto [it, idx] = make_pair(_rules.begin(), size_t(0)); it != _rules.end() and idx < pollfds.size(); ++idx) {
         const auto &this_pollfd = pollfds[idx];
 
         const auto poll_error = static_cast<bool>(this_pollfd.revents & (POLLERR | POLLNVAL));
@@ -147,7 +377,7 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
             this_rule.callback();
             //  如果处理该活跃事件失败，那么立刻退出eventloop. 因为该poll是水平触发. 如果活跃事件处理失败的话会陷入死循环
             // only check for busy wait if we're not canceling or exiting
-            if (count_before == this_rule.service_count() and this_rule.interest()) {
+            if (count_before == this_rule.service_count() and this_rule.interested()) {
                 throw runtime_error(
                     "EventLoop: busy wait detected: callback did not read/write fd and is still interested");
             }
@@ -159,3 +389,156 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
     //  监听并处理成功
     return Result::Success;
 }
+
+//  1. 更新有interest回调的rule的注册  2. epoll_wait() 监听事件  3. 只处理就绪的fd
+EventLoop::Result EventLoop::wait_epoll(const int timeout_ms) {
+    for (auto it = _rules.begin(); it != _rules.end();) {  // NOTE: it gets erased or incremented in loop body
+        if ((it->direction == Direction::In && it->fd.eof()) || it->fd.closed()) {
+            it = cancel_rule(it);
+            continue;
+        }
+        set_interest(*it, it->interested());
+        ++it;
+    }
+    update_registrations();
+
+    //  quit if there is nothing left to poll
+    if (_interested == 0) {
+        return Result::Exit;
+    }
+
+    _ready.resize(max(_registrations.size(), size_t{1}));
+    int ready_count = 0;
+    try {
+        ready_count = SystemCall("epoll_wait", ::epoll_wait(_epoll->fd_num(), _ready.data(), _ready.size(), timeout_ms));
+    } catch (unix_error const &e) {
+        if (e.code().value() == EINTR) {
+            _interrupted = true;
+            return Result::Exit;
+        }
+        throw;
+    }
+    if (ready_count == 0) {
+        return Result::Timeout;
+    }
+
+    for (int i = 0; i < ready_count; ++i) {
+        const int fd_num = _ready[i].data.fd;
+        const uint32_t revents = _ready[i].events;
+        if (revents & EPOLLERR) {
+            throw runtime_error("EventLoop: error on polled file descriptor");
+        }
+
+        const auto registration = _registrations.find(fd_num);
+        if (registration == _registrations.end()) {
+            continue;
+        }
+        //  callback里可能add_rule到同一个fd上, 所以遍历副本
+        const auto rules = registration->second.rules;
+        for (const auto &rule : rules) {
+            if (not rule->registered) {
+                continue;  //  poll中events为0的占位项
+            }
+            const bool ready = revents & static_cast<uint16_t>(rule->direction);
+            //  与poll相同: 关注的方向没有就绪, 只有hangup, 这个rule不会再就绪了
+            if ((revents & EPOLLHUP) && !ready) {
+                cancel_rule(rule);
+                continue;
+            }
+            if (ready) {
+                const auto count_before = rule->service_count();
+                rule->callback();
+                if (count_before == rule->service_count() and rule->interested()) {
+                    throw runtime_error(
+                        "EventLoop: busy wait detected: callback did not read/write fd and is still interested");
+                }
+                //  没有interest回调的rule不会在开头被检查, 在这里取消
+                if ((rule->direction == Direction::In && rule->fd.eof()) || rule->fd.closed()) {
+                    cancel_rule(rule);
+                }
+            }
+        }
+    }
+    update_registrations();
+
+    return Result::Success;
+}
+
+#ifdef HAVE_IO_URING
+//  1. arm/disarm有interest回调的rule  2. 一次io_uring_enter提交并等待  3. 处理完成的poll, 重新arm静态rule
+EventLoop::Result EventLoop::wait_io_uring(const int timeout_ms) {
+    for (auto it = _rules.begin(); it != _rules.end();) {  // NOTE: it gets erased or incremented in loop body
+        if ((it->direction == Direction::In && it->fd.eof()) || it->fd.closed()) {
+            it = cancel_rule(it);
+            continue;
+        }
+        const bool interested = it->interested();
+        if (interested && it->armed_poll == 0) {
+            arm(it);
+        } else if (not interested) {
+            disarm(*it);
+        }
+        ++it;
+    }
+
+    //  quit if there is nothing left to poll
+    if (_interested == 0) {
+        return Result::Exit;
+    }
+
+    try {
+        _ring->submit_and_wait(timeout_ms);
+    } catch (unix_error const &e) {
+        if (e.code().value() == EINTR) {
+            _interrupted = true;
+            return Result::Exit;
+        }
+        throw;
+    }
+
+    bool triggered = false;
+    for (const auto &completion : _ring->reap()) {
+        //  已被disarm或取消的rule的poll, 以及失败的remove
+        const auto armed = _armed.find(completion.user_data);
+        if (armed == _armed.end()) {
+            continue;
+        }
+        //  one-shot: 这个poll已经结束
+        const auto rule = armed->second;
+        _armed.erase(armed);
+        rule->armed_poll = 0;
+        --_interested;
+        triggered = true;
+
+        const uint32_t revents = completion.res;
+        if (completion.res < 0 or (revents & (POLLERR | POLLNVAL))) {
+            throw runtime_error("EventLoop: error on polled file descriptor");
+        }
+        const bool ready = revents & static_cast<uint16_t>(rule->direction);
+        if ((revents & POLLHUP) && !ready) {
+            cancel_rule(rule);
+            continue;
+        }
+        if (ready) {
+            const auto count_before = rule->service_count();
+            rule->callback();
+            if (count_before == rule->service_count() and rule->interested()) {
+                throw runtime_error(
+                    "EventLoop: busy wait detected: callback did not read/write fd and is still interested");
+            }
+            if ((rule->direction == Direction::In && rule->fd.eof()) || rule->fd.closed()) {
+                cancel_rule(rule);
+                continue;
+            }
+        }
+        //  有interest回调的rule在下次wait开头重新arm
+        if (not rule->interest) {
+            arm(rule);
+        }
+    }
+
+    return triggered ? Result::Success : Result::Timeout;
+}
+#else
+EventLoop::Result EventLoop::wait_io_uring(const int) { return Result::Exit; }
+#endif
@@ -3,10 +3,20 @@
 
 #include "file_descriptor.hh"
 
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <list>
+#include <memory>
+#include <optional>
 #include <poll.h>
+#include <set>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class IoUring;
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop {
@@ -17,6 +27,27 @@ class EventLoop {
         Out = POLLOUT  //!< Callback will be triggered when Rule::fd is writable.
     };
 
+    //! How an EventLoop waits for its file descriptors; chosen at construction.
+    enum class Backend {
+        Poll,  //!< [poll(2)](\ref man2::poll) on a list rebuilt from every Rule on each call
+        Epoll,  //!< [epoll(7)](\ref man7::epoll) with persistent registrations, updated when interest changes
+        //! [io_uring(7)](\ref man7::io_uring) poll requests, armed and reaped in one system call per wait (needs
+        //! Linux 5.17 or later, at build time and at run time; otherwise the EventLoop constructor throws)
+        IoUring
+    };
+
+    //! Returned by each call to EventLoop::wait_next_event.
+    enum class Result {
+        Success,  //!< At least one Rule was triggered.
+        Timeout,  //!< No rules were triggered before timeout.
+        //! All rules have been canceled or were uninterested, and no timer is pending; make no further calls to
+        //! EventLoop::wait_next_event.
+        Exit
+    };
+
+    //! Identifies a timer added with EventLoop::add_timer
+    using TimerId = uint64_t;
+
   private:
     using CallbackT = std::function<void(void)>;  //!< Callback for ready Rule::fd
     using InterestT = std::function<bool(void)>;  //!< `true` return indicates Rule::fd should be polled.
@@ -28,33 +59,112 @@ class EventLoop {
         FileDescriptor fd;    //!< FileDescriptor to monitor for activity.
         Direction direction;  //!< Direction::In for reading from fd, Direction::Out for writing to fd.
         CallbackT callback;   //!< A callback that reads or writes fd.
-        InterestT interest;   //!< A callback that returns `true` whenever fd should be polled.
+        InterestT interest;   //!< A callback that returns `true` whenever fd should be polled (empty: always).
         CallbackT cancel;     //!< A callback that is called when the rule is cancelled (e.g. on hangup)
+        bool registered{false};  //!< Backend::Epoll: is `direction` in the fd's epoll registration?
+        uint64_t armed_poll{0};  //!< Backend::IoUring: user_data of the pending poll request, or 0
 
         //! Returns the number of times fd has been read or written, depending on the value of Rule::direction.
         //! \details This function is used internally by EventLoop; you will not need to call it
         unsigned int service_count() const;
+
+        //! Calls Rule::interest, if there is one
+        bool interested() const { return not interest or interest(); }
     };
 
-    std::list<Rule> _rules{};  //!< All rules that have been added and not canceled.
+    using RuleList = std::list<Rule>;  //!< Rules in the order they are serviced
 
-  public:
-    //! Returned by each call to EventLoop::wait_next_event.
-    enum class Result {
-        Success,  //!< At least one Rule was triggered.
-        Timeout,  //!< No rules were triggered before timeout.
-        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
+    //! Backend::Epoll: the rules on one file descriptor, and the events it is registered for
+    struct Registration {
+        std::vector<RuleList::iterator> rules{};
+        uint32_t events{0};
     };
 
+    Backend _backend;
+
+    //! All rules that have been added and not canceled (with Backend::Epoll or Backend::IoUring, only those with
+    //! an interest callback, which are the ones visited on every call).
+    RuleList _rules{};
+
+    //! Backend::Epoll and Backend::IoUring: rules without an interest callback
+    RuleList _always_interested{};
+    //! Backend::Epoll and Backend::IoUring: rules whose direction is being waited for
+    size_t _interested{0};
+
+    //! \name Backend::Epoll state
+    //!@{
+    std::optional<FileDescriptor> _epoll{};                  //!< the epoll instance
+    std::unordered_map<int, Registration> _registrations{};  //!< by fd number
+    std::vector<int> _dirty{};                               //!< fds whose rules' interest changed since the last epoll_ctl
+    std::vector<struct epoll_event> _ready{};                //!< filled in by epoll_wait
+    //!@}
+
+    //! \name Backend::IoUring state
+    //!@{
+#ifdef HAVE_IO_URING
+    std::unique_ptr<IoUring> _ring{};
+#endif
+    std::unordered_map<uint64_t, RuleList::iterator> _armed{};  //!< rules by Rule::armed_poll
+    uint64_t _next_poll{1};                                     //!< user_data for the next poll request
+    //!@}
+
+    //! \name Timers
+    //!@{
+    std::set<std::pair<uint64_t, TimerId>> _timer_queue{};  //!< pending timers by deadline (timestamp_ms())
+    std::unordered_map<TimerId, std::pair<uint64_t, CallbackT>> _timers{};  //!< deadline and callback of each
+    TimerId _next_timer{1};
+    //!@}
+
+    bool _interrupted{false};  //!< was the last wait interrupted by a signal?
+
+    //! Call the callbacks of the timers that are due; returns whether there were any
+    bool run_timers();
+
+    Result wait_poll(const int timeout_ms);
+    Result wait_epoll(const int timeout_ms);
+    Result wait_io_uring(const int timeout_ms);
+
+    //! Backend::Epoll: record whether a rule's direction should be in its fd's registration
+    void set_interest(Rule &rule, const bool interested);
+    //! Backend::Epoll: bring the registration of each fd with a changed rule up to date
+    void update_registrations();
+    //! Backend::IoUring: queue a poll request for the rule's direction
+    void arm(const RuleList::iterator rule);
+    //! Backend::IoUring: queue the removal of the rule's pending poll request
+    void disarm(Rule &rule);
+    //! Backend::Epoll or Backend::IoUring: cancel a rule and stop waiting for its fd
+    RuleList::iterator cancel_rule(const RuleList::iterator rule);
+
+  public:
+    //! Construct an EventLoop that waits with the given Backend
+    explicit EventLoop(const Backend backend = Backend::Poll);
+    ~EventLoop();
+
+    //! \name
+    //! An EventLoop can be moved, but not copied
+
+    //!@{
+    EventLoop(EventLoop &&other);
+    EventLoop &operator=(EventLoop &&other);
+    //!@}
+
     //! Add a rule whose callback will be called when `fd` is ready in the specified Direction.
     void add_rule(const FileDescriptor &fd,
                   const Direction direction,
                   const CallbackT &callback,
-                  const InterestT &interest = [] { return true; },
+                  const InterestT &interest = {},
                   const CallbackT &cancel = [] {});
 
+    //! Call `callback` once, from EventLoop::wait_next_event, when `delay_ms` milliseconds have passed
+    TimerId add_timer(const uint64_t delay_ms, const CallbackT &callback);
+
+    //! Forget a timer (nothing happens if it has already fired or been canceled)
+    void cancel_timer(const TimerId timer);
+
     //  reactor
-    //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+    //! Calls [poll(2)](\ref man2::poll), [epoll_wait(2)](\ref man2::epoll_wait) or
+    //! [io_uring_enter(2)](\ref man2::io_uring_enter) and then executes callback for each ready fd and each
+    //! timer that is due.
     Result wait_next_event(const int timeout_ms);
 };
 
@@ -73,5 +183,21 @@ using Direction = EventLoop::Direction;
 //! A Rule installed using EventLoop::add_cancelable_rule will be polled and canceled under the
 //! same conditions, with the additional condition that if Rule::callback returns `true`, the
 //! Rule will be canceled.
+//!
+//! With Backend::Epoll, each fd stays registered with the kernel between calls. Only rules that were
+//! given an interest callback are visited on every call, and a change in their interest costs one
+//! [epoll_ctl(2)](\ref man2::epoll_ctl); a call therefore costs O(ready fds + rules with interest callbacks)
+//! rather than O(rules). A rule without an interest callback is checked for EOF or closure only after its
+//! callback runs.
+//!
+//! Timers added with EventLoop::add_timer bound how long EventLoop::wait_next_event sleeps, so a caller
+//! that only needs to wake up for I/O and for its own deadlines can pass a timeout of -1 instead of polling
+//! at a fixed interval.
+//!
+//! With Backend::IoUring, each interested rule has a one-shot poll request pending in the ring. A call submits
+//! the requests that need (re-)arming and waits for completions in a single
+//! [io_uring_enter(2)](\ref man2::io_uring_enter); a rule without an interest callback is re-armed as soon as
+//! its callback has run, and a rule that loses interest has its request removed. Since a one-shot poll checks
+//! readiness when it is armed, the semantics are those of level-triggered poll, busy-wait detection included.
 
 #endif  // SPONGE_LIBSPONGE_EVENTLOOP_HH
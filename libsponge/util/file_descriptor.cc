@@ -76,6 +76,9 @@ string FileDescriptor::read(const size_t limit) {
     string ret;
 
     read(ret, limit);
+    //  read()先resize到1MiB再读; 返回的string可能被切成Buffer长期持有(例如reassembler中的payload slice),
+    //  故释放多余的容量, 不让一个小数据包占住1MiB
+    ret.shrink_to_fit();
     return ret;
 }
 
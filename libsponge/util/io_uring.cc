@@ -0,0 +1,107 @@
+#include "io_uring.hh"
+
+#include "util.hh"
+
+#include <cerrno>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+//  和内核共享的ring下标: 读对方写的用acquire, 写给对方的用release
+static unsigned load_acquire(const unsigned *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void store_release(unsigned *p, const unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+static int io_uring_setup(const unsigned entries, io_uring_params &params) {
+    const int fd = SystemCall("io_uring_setup", static_cast<int>(syscall(__NR_io_uring_setup, entries, &params)));
+    constexpr uint32_t needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_CQE_SKIP;
+    if ((params.features & needed) != needed) {
+        ::close(fd);
+        throw runtime_error("io_uring: kernel lacks required features (Linux 5.17 or later is needed)");
+    }
+    return fd;
+}
+
+IoUring::Mapping::Mapping(const int ring_fd, const size_t length, const off_t offset)
+    : _addr(::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset))
+    , _length(length) {
+    if (_addr == MAP_FAILED) {
+        throw unix_error("mmap");
+    }
+}
+
+IoUring::Mapping::~Mapping() { ::munmap(_addr, _length); }
+
+//! \param[in] entries is the size of the submission queue; the kernel rounds it up to a power of two, and
+//!                    makes the completion queue twice as large
+IoUring::IoUring(const unsigned entries)
+    : _params()
+    , _ring(io_uring_setup(entries, _params))
+    , _rings(_ring.fd_num(),
+             max(_params.sq_off.array + _params.sq_entries * sizeof(unsigned),
+                 _params.cq_off.cqes + _params.cq_entries * sizeof(io_uring_cqe)),
+             IORING_OFF_SQ_RING)
+    , _sqe_array(_ring.fd_num(), _params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES)
+    , _sq_head(_rings.at<unsigned>(_params.sq_off.head))
+    , _sq_tail(_rings.at<unsigned>(_params.sq_off.tail))
+    , _sq_array(_rings.at<unsigned>(_params.sq_off.array))
+    , _sqes(_sqe_array.at<io_uring_sqe>(0))
+    , _sq_local_tail(*_sq_tail)
+    , _cq_head(_rings.at<unsigned>(_params.cq_off.head))
+    , _cq_tail(_rings.at<unsigned>(_params.cq_off.tail))
+    , _cqes(_rings.at<io_uring_cqe>(_params.cq_off.cqes)) {}
+
+io_uring_sqe &IoUring::next_sqe() {
+    //  SQ满了: 先把已排队的提交掉
+    if (_sq_local_tail - load_acquire(_sq_head) == _params.sq_entries) {
+        enter(false, 0);
+    }
+    const unsigned index = _sq_local_tail & (_params.sq_entries - 1);
+    _sq_array[index] = index;
+    _sqes[index] = {};
+    ++_sq_local_tail;
+    return _sqes[index];
+}
+
+//  一次io_uring_enter: 提交排队的SQE, 并且(可选)带超时等待一个completion
+void IoUring::enter(const bool wait, const int timeout_ms) {
+    store_release(_sq_tail, _sq_local_tail);
+    const unsigned to_submit = _sq_local_tail - load_acquire(_sq_head);
+
+    unsigned flags = 0;
+    __kernel_timespec timeout{};
+    io_uring_getevents_arg arg{};
+    if (wait) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout_ms > 0) {
+            timeout.tv_sec = timeout_ms / 1000;
+            timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+            arg.ts = reinterpret_cast<uint64_t>(&timeout);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+    }
+    //  超时返回ETIME, 不是错误; EINTR交给调用者
+    SystemCall("io_uring_enter",
+               static_cast<int>(syscall(__NR_io_uring_enter,
+                                        _ring.fd_num(),
+                                        to_submit,
+                                        wait ? 1 : 0,
+                                        flags,
+                                        (flags & IORING_ENTER_EXT_ARG) ? &arg : nullptr,
+                                        (flags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0)),
+               ETIME);
+}
+
+const vector<IoUring::Completion> &IoUring::reap() {
+    _completions.clear();
+    unsigned head = *_cq_head;
+    const unsigned tail = load_acquire(_cq_tail);
+    for (; head != tail; ++head) {
+        const io_uring_cqe &cqe = _cqes[head & (_params.cq_entries - 1)];
+        _completions.push_back({cqe.user_data, cqe.res});
+    }
+    store_release(_cq_head, head);
+    return _completions;
+}
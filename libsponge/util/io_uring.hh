@@ -0,0 +1,85 @@
+#ifndef SPONGE_LIBSPONGE_IO_URING_HH
+#define SPONGE_LIBSPONGE_IO_URING_HH
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <vector>
+
+//! \brief A minimal wrapper around an [io_uring(7)](\ref man7::io_uring) instance, without liburing
+//! \details Requires Linux 5.17 or later (IORING_FEAT_EXT_ARG and IORING_FEAT_CQE_SKIP).
+class IoUring {
+  public:
+    //! The fields of an io_uring_cqe that callers need
+    struct Completion {
+        uint64_t user_data;  //!< io_uring_sqe::user_data of the request that completed
+        int32_t res;         //!< Result of the request: a return value, or a negative errno
+    };
+
+  private:
+    //! A region of the ring shared with the kernel; unmapped on destruction
+    class Mapping {
+        void *_addr;
+        size_t _length;
+
+      public:
+        //! [mmap(2)](\ref man2::mmap) `length` bytes of the ring at `offset`
+        Mapping(const int ring_fd, const size_t length, const off_t offset);
+        ~Mapping();
+
+        //! Pointer to the location `offset` bytes into the region
+        template <typename T>
+        T *at(const size_t offset) const {
+            return reinterpret_cast<T *>(static_cast<char *>(_addr) + offset);
+        }
+
+        Mapping(const Mapping &other) = delete;
+        Mapping &operator=(const Mapping &other) = delete;
+    };
+
+    io_uring_params _params;
+    FileDescriptor _ring;
+    Mapping _rings;  //!< submission and completion rings (IORING_FEAT_SINGLE_MMAP)
+    Mapping _sqe_array;
+
+    //! \name Submission queue
+    //!@{
+    unsigned *_sq_head;
+    unsigned *_sq_tail;
+    unsigned *_sq_array;
+    io_uring_sqe *_sqes;
+    unsigned _sq_local_tail;  //!< one past the last SQE handed out by next_sqe()
+    //!@}
+
+    //! \name Completion queue
+    //!@{
+    unsigned *_cq_head;
+    unsigned *_cq_tail;
+    io_uring_cqe *_cqes;
+    std::vector<Completion> _completions{};
+    //!@}
+
+    //! Submit the queued SQEs and, if `wait`, wait up to `timeout_ms` for a completion
+    void enter(const bool wait, const int timeout_ms);
+
+  public:
+    //! Set up a ring with room for `entries` queued submissions
+    explicit IoUring(const unsigned entries);
+
+    //! A zeroed SQE, queued for the next submission (submits the queue first if it is full)
+    io_uring_sqe &next_sqe();
+
+    //! Submit the queued SQEs, then wait until at least one completion is available or `timeout_ms`
+    //! elapses (-1 waits forever, 0 doesn't wait)
+    void submit_and_wait(const int timeout_ms) { enter(timeout_ms != 0, timeout_ms); }
+
+    //! Remove the completions that are available from the ring; valid until the next call
+    const std::vector<Completion> &reap();
+
+    IoUring(const IoUring &other) = delete;
+    IoUring &operator=(const IoUring &other) = delete;
+};
+
+#endif  // SPONGE_LIBSPONGE_IO_URING_HH
@@ -0,0 +1,191 @@
+#include "ring_stream.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+ByteRing::ByteRing(const size_t capacity) : _storage() {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    _storage.resize(size);
+}
+
+//  先发布新的_written_total再读_read_total: 读出来等于写之前的位置, 说明reader已读空 (它可能在等)
+ByteRing::Transfer ByteRing::write(const BufferViewList &buffer) {
+    const size_t written = _written_total.load(memory_order_relaxed);
+    const size_t room = _storage.size() - (written - _read_total.load());
+    const size_t mask = _storage.size() - 1;
+    size_t copied = 0;
+    for (const auto &iov : buffer.as_iovecs()) {
+        const size_t len = min(iov.iov_len, room - copied);
+        const size_t offset = (written + copied) & mask;
+        const size_t first = min(len, _storage.size() - offset);
+        memcpy(&_storage[offset], iov.iov_base, first);
+        memcpy(_storage.data(), static_cast<const char *>(iov.iov_base) + first, len - first);
+        copied += len;
+        if (copied == room) {
+            break;
+        }
+    }
+    if (copied == 0) {
+        return {0, false};
+    }
+    _written_total.store(written + copied);
+    return {copied, _read_total.load() == written};
+}
+
+void ByteRing::end_input() { _input_ended.store(true); }
+
+//  先发布新的_read_total再读_written_total: ring在读之前是满的, 说明writer可能在等空间
+ByteRing::Transfer ByteRing::read(string &out, const size_t limit) {
+    const size_t read = _read_total.load(memory_order_relaxed);
+    const size_t len = min(limit, _written_total.load() - read);
+    if (len == 0) {
+        return {0, false};
+    }
+    const size_t offset = read & (_storage.size() - 1);
+    const size_t first = min(len, _storage.size() - offset);
+    out.append(&_storage[offset], first);
+    out.append(_storage.data(), len - first);
+    _read_total.store(read + len);
+    return {len, _written_total.load() - read == _storage.size()};
+}
+
+void ByteRing::close_output() { _output_closed.store(true); }
+
+//  先看_input_ended: writer在结束之前写的数据此时一定都可见了
+bool ByteRing::eof() const { return input_ended() and buffer_size() == 0; }
+
+//! The two rings and the two eventfds shared by the ends of a RingStream
+struct RingStream::Channel {
+    array<ByteRing, 2> rings;          //!< rings[i] is written by end i
+    array<FileDescriptor, 2> events;  //!< events[i] is written to wake end i
+
+    explicit Channel(const size_t capacity)
+        : rings{ByteRing(capacity), ByteRing(capacity)}
+        , events{FileDescriptor(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))),
+                 FileDescriptor(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)))} {}
+};
+
+RingStream::RingStream(shared_ptr<Channel> channel, const size_t end) : _channel(move(channel)), _end(end) {}
+
+pair<RingStream, RingStream> RingStream::make_pair(const size_t capacity) {
+    auto channel = make_shared<Channel>(capacity);
+    return {RingStream(channel, 0), RingStream(channel, 1)};
+}
+
+ByteRing &RingStream::_input() { return _channel->rings[1 - _end]; }
+
+const ByteRing &RingStream::_input() const { return _channel->rings[1 - _end]; }
+
+ByteRing &RingStream::_output() { return _channel->rings[_end]; }
+
+void RingStream::_wake_peer() {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(_channel->events[1 - _end].fd_num(), &one, sizeof(one)));
+}
+
+void RingStream::_wait() {
+    pollfd pfd{event_fd().fd_num(), POLLIN, 0};
+    SystemCall("poll", ::poll(&pfd, 1, -1));
+    clear_event();
+}
+
+//  读到0字节才能等: 读到过数据之后writer又写的, writer不一定会唤醒 (见ByteRing)
+string RingStream::read(const size_t limit) {
+    string data;
+    while (true) {
+        const auto transfer = _input().read(data, limit);
+        if (transfer.wake_peer) {
+            _wake_peer();
+        }
+        if (transfer.bytes > 0 or limit == 0 or _input().eof() or not _blocking) {
+            return data;
+        }
+        _wait();
+    }
+}
+
+//  同理: 只有一个字节都写不进去时才等reader腾出空间
+size_t RingStream::write(BufferViewList buffer, const bool write_all) {
+    size_t total = 0;
+    while (buffer.size() > 0) {
+        if (closed_by_peer()) {
+            throw runtime_error("RingStream: write after the other end shut down reading");
+        }
+        if (_output().input_ended()) {
+            throw runtime_error("RingStream: write after shutdown(SHUT_WR)");
+        }
+        const auto transfer = _output().write(buffer);
+        if (transfer.wake_peer) {
+            _wake_peer();
+        }
+        buffer.remove_prefix(transfer.bytes);
+        total += transfer.bytes;
+        if (transfer.bytes > 0) {
+            if (not write_all) {
+                break;
+            }
+            continue;
+        }
+        if (not _blocking) {
+            break;
+        }
+        _wait();
+    }
+    return total;
+}
+
+bool RingStream::eof() const { return _input().eof(); }
+
+bool RingStream::closed_by_peer() const { return _channel->rings[_end].output_closed(); }
+
+void RingStream::shutdown(const int how) {
+    if (how == SHUT_WR or how == SHUT_RDWR) {
+        _output().end_input();
+    }
+    if (how == SHUT_RD or how == SHUT_RDWR) {
+        _input().close_output();
+    }
+    _wake_peer();
+}
+
+FileDescriptor &RingStream::event_fd() { return _channel->events[_end]; }
+
+void RingStream::clear_event() { event_fd().read(sizeof(uint64_t)); }
+
+RingStream::~RingStream() {
+    if (_channel) {
+        try {
+            shutdown(SHUT_RDWR);
+        } catch (const exception &e) {
+            cerr << "Exception destructing RingStream: " << e.what() << endl;
+        }
+    }
+}
+
+RingStream::RingStream(RingStream &&other) noexcept
+    : _channel(move(other._channel)), _end(other._end), _blocking(other._blocking) {}
+
+RingStream &RingStream::operator=(RingStream &&other) noexcept {
+    if (this != &other) {
+        RingStream old(move(*this));
+        _channel = move(other._channel);
+        _end = other._end;
+        _blocking = other._blocking;
+    }
+    return *this;
+}
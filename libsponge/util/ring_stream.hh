@@ -0,0 +1,143 @@
+#ifndef SPONGE_LIBSPONGE_RING_STREAM_HH
+#define SPONGE_LIBSPONGE_RING_STREAM_HH
+
+#include "buffer.hh"
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! \brief A bounded lock-free byte stream from exactly one writer thread to one reader thread
+//! \details Like SPSCQueue, each side publishes its index before reading the other one with sequentially
+//! consistent atomics, so the result of write() and read() says whether the other side may be waiting for it:
+//! a writer needs to wake the reader only when the reader had read everything, and a reader needs to wake the
+//! writer only when the ring was full.
+class ByteRing {
+  public:
+    //! What ByteRing::write or ByteRing::read did
+    struct Transfer {
+        size_t bytes;    //!< Bytes copied in or out
+        bool wake_peer;  //!< Did this make progress that the other side may be waiting for?
+    };
+
+  private:
+    std::vector<char> _storage;
+    //! Total bytes read; only the reader writes it
+    alignas(64) std::atomic<size_t> _read_total{0};
+    //! Total bytes written; only the writer writes it
+    alignas(64) std::atomic<size_t> _written_total{0};
+    std::atomic_bool _input_ended{false};    //!< Has the writer finished?
+    std::atomic_bool _output_closed{false};  //!< Has the reader stopped reading?
+
+  public:
+    //! Construct a ring that holds up to `capacity` bytes (rounded up to a power of two)
+    explicit ByteRing(const size_t capacity);
+
+    //! Writer: copy in as much of `buffer` as fits
+    Transfer write(const BufferViewList &buffer);
+
+    //! Writer: no more bytes will be written
+    void end_input();
+
+    //! Reader: append up to `limit` bytes to `out`
+    Transfer read(std::string &out, const size_t limit);
+
+    //! Reader: no more bytes will be read, so the writer can give up
+    void close_output();
+
+    bool input_ended() const { return _input_ended.load(); }
+    bool output_closed() const { return _output_closed.load(); }
+    size_t buffer_size() const { return _written_total.load() - _read_total.load(); }
+    size_t remaining_capacity() const { return _storage.size() - buffer_size(); }
+
+    //! Has the writer finished, and has the reader read everything?
+    bool eof() const;
+
+    //! \name
+    //! A ByteRing is shared by two threads in place, so it can't be copied or moved
+
+    //!@{
+    ByteRing(const ByteRing &other) = delete;
+    ByteRing &operator=(const ByteRing &other) = delete;
+    //!@}
+};
+
+//! \brief One end of an in-process, full-duplex byte stream between two threads
+//! \details Works like one end of a socket pair of LocalStreamSockets (read(), write(), eof(), shutdown(), and
+//! blocking or nonblocking mode), but the bytes go through a ByteRing in each direction instead of the kernel,
+//! so a transfer is one copy and no system call. Each end has an [eventfd(2)](\ref man2::eventfd) that the other
+//! end writes when it may be waiting (see ByteRing), so an EventLoop can wait on event_fd() in Direction::In and
+//! then call read() and write() until they would block. Unlike a socket, each end is used by one thread at a time.
+class RingStream {
+  private:
+    struct Channel;
+    std::shared_ptr<Channel> _channel;
+    size_t _end;  //!< 0 or 1
+    bool _blocking{true};
+
+    RingStream(std::shared_ptr<Channel> channel, const size_t end);
+
+    ByteRing &_input();
+    const ByteRing &_input() const;
+    ByteRing &_output();
+    //! Write the other end's eventfd
+    void _wake_peer();
+    //! Wait until the other end wakes this one
+    void _wait();
+
+  public:
+    //! Create two connected ends, each direction buffering up to `capacity` bytes
+    static std::pair<RingStream, RingStream> make_pair(const size_t capacity);
+
+    //! Read up to `limit` bytes; blocks until there is at least one (or EOF) unless set_blocking(false)
+    std::string read(const size_t limit = std::numeric_limits<size_t>::max());
+
+    //! \brief Write a buffer (or part of it, if `write_all` is false or the end is nonblocking)
+    //! \returns the number of bytes written
+    //! \throws std::runtime_error if the other end has shut down reading (where a socket would give EPIPE)
+    size_t write(BufferViewList buffer, const bool write_all = true);
+
+    //! Write a C string (or part of it)
+    size_t write(const char *str, const bool write_all = true) { return write(BufferViewList(str), write_all); }
+
+    //! Write a string (or part of it)
+    size_t write(const std::string &str, const bool write_all = true) { return write(BufferViewList(str), write_all); }
+
+    //! Has the other end shut down writing, with everything it wrote read?
+    bool eof() const;
+
+    //! Has the other end shut down reading, so that write() would throw?
+    bool closed_by_peer() const;
+
+    //! Stop writing (SHUT_WR), reading (SHUT_RD) or both (SHUT_RDWR), like [shutdown(2)](\ref man2::shutdown)
+    void shutdown(const int how);
+
+    //! Set blocking (true) or nonblocking (false) read() and write()
+    void set_blocking(const bool blocking) { _blocking = blocking; }
+
+    //! Readable when the other end has made progress; call clear_event() before read() and write()
+    FileDescriptor &event_fd();
+
+    //! Consume the pending wakeups of event_fd(), once it is readable
+    void clear_event();
+
+    //! Shuts down both directions, so the other end sees EOF
+    ~RingStream();
+
+    //! \name
+    //! Like a socket, an end can be moved but not copied
+
+    //!@{
+    RingStream(RingStream &&other) noexcept;
+    RingStream &operator=(RingStream &&other) noexcept;
+    RingStream(const RingStream &other) = delete;
+    RingStream &operator=(const RingStream &other) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_RING_STREAM_HH
@@ -2,10 +2,21 @@
 
 #include "util.hh"
 
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <unistd.h>
 
+//  内核头文件较旧的系统上补上UDP GSO/GRO的选项号 (include/uapi/linux/udp.h)
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
 using namespace std;
 
 // default constructor for socket of (subclassed) domain and type
@@ -94,38 +105,98 @@ void Socket::shutdown(const int how) {
     }
 }
 
+//! Room for the UDP_GRO control message that recvmsg() attaches to a coalesced datagram
+using gro_control = array<char, CMSG_SPACE(sizeof(int))>;
+
+//! \returns the size of each datagram GRO coalesced into `message`, or 0 if it holds just one
+static size_t gro_segment_size(msghdr &message) {
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO) {
+            int segment_size = 0;
+            memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+            return segment_size;
+        }
+    }
+    return 0;
+}
+
 //! \note If `mtu` is too small to hold the received datagram, this method throws a std::runtime_error
 void UDPSocket::recv(received_datagram &datagram, const size_t mtu) {
     // receive source address and payload
     Address::Raw datagram_source_address;
     datagram.payload.resize(mtu);
 
-    socklen_t fromlen = sizeof(datagram_source_address);
+    iovec iov{datagram.payload.data(), datagram.payload.size()};
+    gro_control control{};
+    msghdr message{};
+    message.msg_name = static_cast<sockaddr *>(datagram_source_address);
+    message.msg_namelen = sizeof(datagram_source_address);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
 
-    const ssize_t recv_len = SystemCall(
-        "recvfrom",
-        ::recvfrom(
-            fd_num(), datagram.payload.data(), datagram.payload.size(), MSG_TRUNC, datagram_source_address, &fromlen));
+    const ssize_t recv_len = SystemCall("recvmsg", ::recvmsg(fd_num(), &message, MSG_TRUNC));
 
     if (recv_len > ssize_t(mtu)) {
-        throw runtime_error("recvfrom (oversized datagram)");
+        throw runtime_error("recvmsg (oversized datagram)");
     }
 
     register_read();
-    datagram.source_address = {datagram_source_address, fromlen};
+    datagram.source_address = {datagram_source_address, message.msg_namelen};
     datagram.payload.resize(recv_len);
+    datagram.segment_size = gro_segment_size(message);
 }
 
 UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
     received_datagram ret{{nullptr, 0}, ""};
     recv(ret, mtu);
+    //  同FileDescriptor::read : 不让payload的Buffer slice占住mtu大小的storage
+    ret.payload.shrink_to_fit();
     return ret;
 }
 
+//! \param[in,out] datagrams receive buffers; payloads shorter than `mtu` are grown first
+//! \param[in] mtu is the largest datagram accepted
+size_t UDPSocket::recv_batch(vector<received_datagram> &datagrams, const size_t mtu) {
+    const size_t batch = datagrams.size();
+    vector<Address::Raw> sources(batch);
+    vector<iovec> iovecs(batch);
+    vector<gro_control> controls(batch);
+    vector<mmsghdr> messages(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        datagrams[i].payload.resize(mtu);
+        iovecs[i] = {datagrams[i].payload.data(), mtu};
+        messages[i].msg_hdr.msg_name = static_cast<sockaddr *>(sources[i]);
+        messages[i].msg_hdr.msg_namelen = sizeof(sources[i].storage);
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_control = controls[i].data();
+        messages[i].msg_hdr.msg_controllen = controls[i].size();
+    }
+
+    //  MSG_WAITFORONE : 只等第一个datagram, 之后有多少收多少 (最多batch个), 一次syscall
+    const int received = SystemCall(
+        "recvmmsg", ::recvmmsg(fd_num(), messages.data(), batch, MSG_WAITFORONE | MSG_TRUNC, nullptr));
+    register_read();
+
+    for (int i = 0; i < received; ++i) {
+        if (messages[i].msg_len > mtu or (messages[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+            throw runtime_error("recvmmsg (oversized datagram)");
+        }
+        datagrams[i].source_address = {sources[i], messages[i].msg_hdr.msg_namelen};
+        datagrams[i].payload.resize(messages[i].msg_len);
+        datagrams[i].segment_size = gro_segment_size(messages[i].msg_hdr);
+    }
+    return received;
+}
+
+//! \param[in] segment_size if nonzero, ask the kernel to split the payload into datagrams of this size (UDP_SEGMENT)
 void sendmsg_helper(const int fd_num,
                     const sockaddr *destination_address,
                     const socklen_t destination_address_len,
-                    const BufferViewList &payload) {
+                    const BufferViewList &payload,
+                    const uint16_t segment_size = 0) {
     auto iovecs = payload.as_iovecs();
 
     msghdr message{};
@@ -134,6 +205,17 @@ void sendmsg_helper(const int fd_num,
     message.msg_iov = iovecs.data();
     message.msg_iovlen = iovecs.size();
 
+    array<char, CMSG_SPACE(sizeof(uint16_t))> control{};
+    if (segment_size > 0) {
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(segment_size));
+        memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    }
+
     const ssize_t bytes_sent = SystemCall("sendmsg", ::sendmsg(fd_num, &message, 0));   
     //  msghr message : 目标ip和port(sockaddr*) + 要发送数据payload
     //  本lab中 该sendmsg 用于通过udp socket fd 发送 udp segment
@@ -154,6 +236,52 @@ void UDPSocket::send(const BufferViewList &payload) {
     register_write();
 }
 
+void UDPSocket::sendto_segmented(const Address &destination,
+                                 const BufferViewList &payload,
+                                 const uint16_t segment_size) {
+    sendmsg_helper(fd_num(), destination, destination.size(), payload, segment_size);
+    register_write();
+}
+
+//! \details Coalesced datagrams are reported through received_datagram::segment_size by recv() and recv_batch().
+bool UDPSocket::set_gro() {
+    const int on = 1;
+    return SystemCall("setsockopt", ::setsockopt(fd_num(), SOL_UDP, UDP_GRO, &on, sizeof(on)), ENOPROTOOPT) == 0;
+}
+
+//! \details Setting the socket's default segment size to 0 (no segmentation) fails only on kernels without GSO.
+bool UDPSocket::gso_supported() {
+    const int off = 0;
+    return SystemCall("setsockopt", ::setsockopt(fd_num(), SOL_UDP, UDP_SEGMENT, &off, sizeof(off)), ENOPROTOOPT) ==
+           0;
+}
+
+void UDPSocket::sendto_batch(const Address &destination, const vector<BufferViewList> &payloads) {
+    vector<vector<iovec>> iovecs;
+    iovecs.reserve(payloads.size());
+    vector<mmsghdr> messages(payloads.size());
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        iovecs.push_back(payloads[i].as_iovecs());
+        messages[i].msg_hdr.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(destination));
+        messages[i].msg_hdr.msg_namelen = destination.size();
+        messages[i].msg_hdr.msg_iov = iovecs[i].data();
+        messages[i].msg_hdr.msg_iovlen = iovecs[i].size();
+    }
+
+    //  sendmmsg可能只发出前一部分 (如被信号打断), 剩下的接着发
+    size_t sent = 0;
+    while (sent < messages.size()) {
+        const int n = SystemCall("sendmmsg", ::sendmmsg(fd_num(), &messages[sent], messages.size() - sent, 0));
+        register_write();
+        for (size_t i = sent; i < sent + n; ++i) {
+            if (messages[i].msg_len != payloads[i].size()) {
+                throw runtime_error("datagram payload too big for sendmmsg()");
+            }
+        }
+        sent += n;
+    }
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen(const int backlog) { SystemCall("listen", ::listen(fd_num(), backlog)); }
@@ -8,6 +8,7 @@
 #include <functional>
 #include <string>
 #include <sys/socket.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -64,23 +65,50 @@ class UDPSocket : public Socket {
     //! Default: construct an unbound, unconnected UDP socket
     UDPSocket() : Socket(AF_INET, SOCK_DGRAM) {}
 
+    //! Most datagrams the kernel will split one UDP_SEGMENT send into
+    static constexpr size_t MAX_GSO_SEGMENTS = 64;
+    //! Most bytes in one UDP_SEGMENT send (the largest IPv4 UDP payload)
+    static constexpr size_t MAX_GSO_BYTES = 65507;
+
     //! Returned by UDPSocket::recv; carries received data and information about the sender
     struct received_datagram {
         Address source_address;  //!< Address from which this datagram was received
         std::string payload;     //!< UDP datagram payload
+        //! With GRO, `payload` may hold several datagrams of this size (the last may be shorter); 0 for one datagram
+        size_t segment_size{0};
     };
 
+    //! \brief Let the kernel coalesce consecutive datagrams from one sender ([UDP_GRO](\ref man7::udp))
+    //! \returns `false` if the kernel doesn't support it
+    bool set_gro();
+
+    //! \brief Check whether the kernel can split large sends into datagrams ([UDP_SEGMENT](\ref man7::udp))
+    bool gso_supported();
+
     //! Receive a datagram and the Address of its sender
     received_datagram recv(const size_t mtu = 65536);
 
     //! Receive a datagram and the Address of its sender (caller can allocate storage)
     void recv(received_datagram &datagram, const size_t mtu = 65536);
 
+    //! \brief Receive up to `datagrams.size()` datagrams with one [recvmmsg(2)](\ref man2::recvmmsg),
+    //! waiting only for the first (caller can keep the storage between calls)
+    //! \returns the number of elements of `datagrams` that were filled in
+    size_t recv_batch(std::vector<received_datagram> &datagrams, const size_t mtu = 65536);
+
     //! Send a datagram to specified Address
     void sendto(const Address &destination, const BufferViewList &payload);
 
     //! Send datagram to the socket's connected address (must call connect() first)
     void send(const BufferViewList &payload);
+
+    //! \brief Send `payload` to specified Address as datagrams of `segment_size` bytes (the last may be shorter),
+    //! split by the kernel ([UDP_SEGMENT](\ref man7::udp)); at most MAX_GSO_SEGMENTS datagrams and MAX_GSO_BYTES bytes
+    void sendto_segmented(const Address &destination, const BufferViewList &payload, const uint16_t segment_size);
+
+    //! Send each payload as one datagram to specified Address, with as few [sendmmsg(2)](\ref man2::sendmmsg)
+    //! calls as possible
+    void sendto_batch(const Address &destination, const std::vector<BufferViewList> &payloads);
 };
 
 //! \class UDPSocket
@@ -89,6 +117,14 @@ class UDPSocket : public Socket {
 //! Example:
 //!
 //! \include socket_example_1.cc
+//!
+//! Batched sends and receives:
+//!
+//! \include socket_example_4.cc
+//!
+//! Segmentation offload (GSO) and receive coalescing (GRO):
+//!
+//! \include socket_example_5.cc
 
 //! A wrapper around [TCP sockets](\ref man7::tcp)
 class TCPSocket : public Socket {
@@ -0,0 +1,73 @@
+#ifndef SPONGE_LIBSPONGE_SPSC_QUEUE_HH
+#define SPONGE_LIBSPONGE_SPSC_QUEUE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//! \brief A bounded lock-free queue between exactly one producer thread and one consumer thread
+//! \details push() is only called by the producer and pop() only by the consumer. Both publish their index
+//! before reading the other one, with sequentially consistent atomics, so when push() returns PushResult::First
+//! the consumer has popped everything before the new item; a consumer that pops until the queue is empty after
+//! each wakeup therefore needs to be woken only then.
+template <typename T>
+class SPSCQueue {
+  public:
+    //! What SPSCQueue::push did
+    enum class PushResult {
+        Full,    //!< The queue was full; the item wasn't added
+        Queued,  //!< Added behind items the consumer hadn't popped yet
+        First    //!< Added when the consumer had popped every earlier item (it may be waiting)
+    };
+
+  private:
+    std::vector<T> _slots;
+    //! Index of the next slot to pop; only the consumer writes it
+    alignas(64) std::atomic<size_t> _head{0};
+    //! Index of the next slot to push; only the producer writes it
+    alignas(64) std::atomic<size_t> _tail{0};
+
+  public:
+    //! Construct a queue that holds up to `capacity` items (rounded up to a power of two)
+    explicit SPSCQueue(const size_t capacity) : _slots() {
+        size_t slots = 1;
+        while (slots < capacity) {
+            slots <<= 1;
+        }
+        _slots.resize(slots);
+    }
+
+    //! Producer: append an item, unless the queue is full (then `item` is left alone)
+    PushResult push(T &&item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load() == _slots.size()) {
+            return PushResult::Full;
+        }
+        _slots[tail & (_slots.size() - 1)] = std::move(item);
+        _tail.store(tail + 1);
+        return _head.load() == tail ? PushResult::First : PushResult::Queued;
+    }
+
+    //! Consumer: remove the oldest item, if there is one
+    std::optional<T> pop() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load()) {
+            return std::nullopt;
+        }
+        std::optional<T> item{std::move(_slots[head & (_slots.size() - 1)])};
+        _head.store(head + 1);
+        return item;
+    }
+
+    //! \name
+    //! An SPSCQueue is shared by two threads in place, so it can't be copied or moved
+
+    //!@{
+    SPSCQueue(const SPSCQueue &other) = delete;
+    SPSCQueue &operator=(const SPSCQueue &other) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_SPSC_QUEUE_HH
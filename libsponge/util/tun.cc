@@ -2,11 +2,19 @@
 
 #include "util.hh"
 
+#ifdef HAVE_IO_URING
+#include "io_uring.hh"
+#endif
+
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <exception>
 #include <fcntl.h>
 #include <linux/if.h>
 #include <linux/if_tun.h>
 #include <sys/ioctl.h>
+#include <unistd.h>
 
 static constexpr const char *CLONEDEV = "/dev/net/tun";
 
@@ -19,18 +27,156 @@ using namespace std;
 //!
 //!     ip tuntap add mode tun user `username` name `devname`
 //!
-//! as root before calling this function.
+//! as root before calling this function. A device created with `multi_queue` (see TunFD::open_queues) is
+//! opened as one of its queues.
 
 TunTapFD::TunTapFD(const string &devname, const bool is_tun)
-    : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))) {
+    : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))), _packet(MAX_PACKET, 0) {
+    //  multi_queue建的设备不带IFF_MULTI_QUEUE打开会得到EINVAL: 这时作为它的一个queue打开
+    if (_attach(devname, is_tun, false, EINVAL) < 0) {
+        _attach(devname, is_tun, true);
+    }
+}
+
+//! \param[in] devname is the name of the TUN or TAP device, specified at its creation.
+//! \param[in] is_tun is `true` for a TUN device, or `false` for a TAP device
+//! \param[in] multi_queue is `true` to open one queue of a device created with
+//!
+//!     ip tuntap add mode tun multi_queue user `username` name `devname`
+//!
+//! Each TunTapFD opened this way is a separate queue (up to 256 per device).
+TunTapFD::TunTapFD(const string &devname, const bool is_tun, const bool multi_queue)
+    : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))), _packet(MAX_PACKET, 0) {
+    _attach(devname, is_tun, multi_queue);
+}
+
+//! \param[in] fd is, for instance, a dup() of a TunTapFD's descriptor, or one end of a datagram socket pair
+TunTapFD::TunTapFD(FileDescriptor &&fd) : FileDescriptor(move(fd)), _packet(MAX_PACKET, 0) {}
+
+int TunTapFD::_attach(const string &devname, const bool is_tun, const bool multi_queue, const int errno_mask) {
     struct ifreq tun_req {};
 
     tun_req.ifr_flags = (is_tun ? IFF_TUN : IFF_TAP) | IFF_NO_PI;  // tun device with no packetinfo
+    if (multi_queue) {
+        tun_req.ifr_flags |= IFF_MULTI_QUEUE;
+    }
 
     // copy devname to ifr_name, making sure to null terminate
 
     strncpy(static_cast<char *>(tun_req.ifr_name), devname.data(), IFNAMSIZ - 1);
     tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
-    SystemCall("ioctl", ioctl(fd_num(), TUNSETIFF, static_cast<void *>(&tun_req)));
+    return SystemCall("ioctl", ioctl(fd_num(), TUNSETIFF, static_cast<void *>(&tun_req)), errno_mask);
+}
+
+//! \param[in] devname is the name of a TUN device created with `multi_queue`
+//! \param[in] queues is how many queues to open
+vector<TunFD> TunFD::open_queues(const string &devname, const size_t queues) {
+    vector<TunFD> fds;
+    fds.reserve(queues);
+    for (size_t i = 0; i < queues; ++i) {
+        fds.emplace_back(devname, true);
+    }
+    return fds;
+}
+
+//! \details The device hands over exactly one packet per [read(2)](\ref man2::read), so unlike FileDescriptor::read,
+//! which sizes a fresh 1 MiB string for every call, this reads into storage kept across calls and copies out
+//! only the bytes received. Like read_batch(), it passes EAGAIN from a nonblocking device through as nothing read.
+string TunTapFD::read() {
+    const ssize_t bytes_read = SystemCall("read", ::read(fd_num(), _packet.data(), _packet.size()), EAGAIN);
+    register_read();
+    if (bytes_read < 0) {
+        return {};
+    }
+    return _packet.substr(0, bytes_read);
+}
+
+TunTapFD::~TunTapFD() = default;
+
+TunTapFD::TunTapFD(TunTapFD &&other) noexcept = default;
+
+TunTapFD &TunTapFD::operator=(TunTapFD &&other) noexcept = default;
+
+//  第一次write_batch时才创建; 内核(或编译时的头文件)不支持io_uring时退回逐个writev
+IoUring *TunTapFD::_batch_ring() {
+#ifndef HAVE_IO_URING
+    return nullptr;
+#else
+    if (not _ring_tried) {
+        _ring_tried = true;
+        try {
+            _ring = make_unique<IoUring>(MAX_BATCH);
+        } catch (const exception &) {
+            _ring.reset();
+        }
+    }
+    return _ring.get();
+#endif
+}
+
+//! \details A TUN/TAP device hands over one packet per [read(2)](\ref man2::read), so this reads until the
+//! nonblocking device has nothing left (EAGAIN), and one wakeup of the caller's EventLoop drains a whole burst.
+//! (io_uring can't batch these reads: it parks a read of a pollable file that would block, instead of failing it
+//! with EAGAIN, so the reads past the last waiting packet would wait for more.)
+vector<string> TunTapFD::read_batch(const size_t max_packets) {
+    vector<string> packets;
+    while (packets.size() < max_packets) {
+        const ssize_t bytes_read = SystemCall("read", ::read(fd_num(), _packet.data(), _packet.size()), EAGAIN);
+        register_read();
+        if (bytes_read < 0) {
+            break;
+        }
+        packets.push_back(_packet.substr(0, bytes_read));
+    }
+    return packets;
+}
+
+//! \details Each packet is written with [writev(2)](\ref man2::writev) over its BufferList, so nothing is
+//! concatenated, and up to `max_per_call` writes are linked (to keep them in order) and submitted through
+//! io_uring together. Without io_uring, this is one writev() per packet.
+void TunTapFD::write_batch(const vector<BufferList> &packets, [[maybe_unused]] const size_t max_per_call) {
+    IoUring *ring = _batch_ring();
+    if (ring == nullptr) {
+        for (const auto &packet : packets) {
+            write(BufferViewList(packet));
+        }
+        return;
+    }
+
+#ifdef HAVE_IO_URING
+    const size_t batch = clamp<size_t>(max_per_call, 1, MAX_BATCH);
+    for (size_t first = 0; first < packets.size(); first += batch) {
+        const size_t count = min(batch, packets.size() - first);
+        vector<vector<iovec>> iovecs;
+        iovecs.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            iovecs.push_back(BufferViewList(packets[first + i]).as_iovecs());
+            io_uring_sqe &sqe = ring->next_sqe();
+            sqe.opcode = IORING_OP_WRITEV;
+            sqe.fd = fd_num();
+            sqe.addr = reinterpret_cast<uint64_t>(iovecs.back().data());
+            sqe.len = iovecs.back().size();
+            sqe.flags = i + 1 < count ? IOSQE_IO_LINK : 0;
+            sqe.user_data = i;
+        }
+        //  一个write失败后, link上后面的write都以ECANCELED结束; 报告真正的错误
+        int error = 0;
+        for (size_t done = 0; done < count;) {
+            ring->submit_and_wait(-1);
+            for (const auto &completion : ring->reap()) {
+                if (completion.res < 0 and (error == 0 or error == ECANCELED)) {
+                    error = -completion.res;
+                }
+                ++done;
+            }
+        }
+        if (error != 0) {
+            throw unix_error("writev", error);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            register_write();
+        }
+    }
+#endif
 }
@@ -1,15 +1,66 @@
 #ifndef SPONGE_LIBSPONGE_TUN_HH
 #define SPONGE_LIBSPONGE_TUN_HH
 
+#include "buffer.hh"
 #include "file_descriptor.hh"
 
+#include <memory>
 #include <string>
+#include <vector>
+
+class IoUring;
 
 //! A FileDescriptor to a [Linux TUN/TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
 class TunTapFD : public FileDescriptor {
+  private:
+    std::string _packet;  //!< Storage that every read() reuses, big enough for any packet or frame
+
+    //! Attach to the device (TUNSETIFF); returns -1 instead of throwing if the error is `errno_mask`
+    int _attach(const std::string &devname, const bool is_tun, const bool multi_queue, const int errno_mask = 0);
+
+    //! \name Batched I/O
+    //!@{
+#ifdef HAVE_IO_URING
+    std::unique_ptr<IoUring> _ring{};  //!< submits a batch's writes together
+    bool _ring_tried{false};           //!< has creating _ring been attempted (it fails on kernels before 5.17)?
+#endif
+
+    //! The ring for write_batch(), or nullptr to fall back to one system call per packet
+    IoUring *_batch_ring();
+    //!@}
+
   public:
+    static constexpr size_t MAX_PACKET = 65536;  //!< Largest datagram (TUN) or frame (TAP) that read() accepts
+    static constexpr size_t MAX_BATCH = 64;      //!< Most packets that write_batch() submits at once
+
     //! Open an existing persistent [TUN or TAP device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
     explicit TunTapFD(const std::string &devname, const bool is_tun);
+
+    //! Open one queue of an existing persistent TUN or TAP device, which must have been created with `multi_queue`
+    TunTapFD(const std::string &devname, const bool is_tun, const bool multi_queue);
+
+    //! Take over a descriptor that already carries one packet per read() and write() (e.g. a datagram socket)
+    explicit TunTapFD(FileDescriptor &&fd);
+
+    //! Read one datagram (TUN) or frame (TAP), or an empty string if the device is nonblocking and has none waiting
+    std::string read();
+
+    //! \brief Read up to `max_packets` datagrams or frames that are already waiting, until the device has no more
+    //! \note The device must be nonblocking (see FileDescriptor::set_blocking).
+    std::vector<std::string> read_batch(const size_t max_packets);
+
+    //! Write each element of `packets` as one datagram or frame, submitting up to `max_per_call` at once
+    void write_batch(const std::vector<BufferList> &packets, const size_t max_per_call = MAX_BATCH);
+
+    ~TunTapFD();
+
+    //! \name
+    //! Moved like any FileDescriptor (the batch ring goes along)
+
+    //!@{
+    TunTapFD(TunTapFD &&other) noexcept;
+    TunTapFD &operator=(TunTapFD &&other) noexcept;
+    //!@}
 };
 
 //! A FileDescriptor to a [Linux TUN](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
@@ -17,6 +68,14 @@ class TunFD : public TunTapFD {
   public:
     //! Open an existing persistent [TUN device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
     explicit TunFD(const std::string &devname) : TunTapFD(devname, true) {}
+
+    //! Open one queue of an existing persistent multiqueue TUN device
+    TunFD(const std::string &devname, const bool multi_queue) : TunTapFD(devname, true, multi_queue) {}
+
+    //! \brief Open `queues` queues of an existing persistent multiqueue TUN device, one TunFD each
+    //! \details The kernel spreads the datagrams it sends among the queues by flow, and remembers which queue each
+    //! flow was last written to, so that its replies come back on the same queue.
+    static std::vector<TunFD> open_queues(const std::string &devname, const size_t queues);
 };
 
 //! A FileDescriptor to a [Linux TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
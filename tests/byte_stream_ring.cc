@@ -0,0 +1,92 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            ByteStreamTestHarness test{"ring: write-pop-write wraps around", 5, ByteStream::Backend::Ring};
+
+            test.execute(Write{"abcd"}.with_bytes_written(4));
+            test.execute(Pop{3});
+            test.execute(BufferSize{1});
+            test.execute(RemainingCapacity{4});
+
+            test.execute(Write{"efghij"}.with_bytes_written(4));
+
+            test.execute(BufferSize{5});
+            test.execute(RemainingCapacity{0});
+            test.execute(BytesWritten{8});
+            test.execute(BytesRead{3});
+            test.execute(Peek{"defgh"});
+
+            test.execute(Pop{2});
+            test.execute(Peek{"fgh"});
+            test.execute(Write{"xy"}.with_bytes_written(2));
+            test.execute(Peek{"fghxy"});
+
+            test.execute(EndInput{});
+            test.execute(Pop{5});
+
+            test.execute(BufferEmpty{true});
+            test.execute(Eof{true});
+            test.execute(BytesWritten{10});
+            test.execute(BytesRead{10});
+        }
+
+        {
+            ByteStreamTestHarness test{"ring: zero capacity", 0, ByteStream::Backend::Ring};
+
+            test.execute(Write{"cat"}.with_bytes_written(0));
+            test.execute(Pop{1});
+            test.execute(Peek{""});
+            test.execute(RemainingCapacity{0});
+            test.execute(BufferEmpty{true});
+        }
+
+        {
+            auto rd = get_random_generator();
+            const size_t NREPS = 1000;
+            const size_t CAPACITY = 97;
+
+            ByteStreamTestHarness test{"ring: random writes and pops", CAPACITY, ByteStream::Backend::Ring};
+
+            string expected;
+            size_t written = 0;
+            size_t popped = 0;
+            for (size_t i = 0; i < NREPS; ++i) {
+                string d(rd() % 64, 0);
+                generate(d.begin(), d.end(), [&] { return 'a' + (rd() % 26); });
+
+                const size_t accepted = min(d.size(), CAPACITY - expected.size());
+                test.execute(Write{d}.with_bytes_written(accepted));
+                expected.append(d.substr(0, accepted));
+                written += accepted;
+
+                test.execute(Peek{expected});
+
+                const size_t to_pop = rd() % (expected.size() + 1);
+                test.execute(Pop{to_pop});
+                expected.erase(0, to_pop);
+                popped += to_pop;
+
+                test.execute(BufferSize{expected.size()});
+                test.execute(RemainingCapacity{CAPACITY - expected.size()});
+                test.execute(BytesWritten{written});
+                test.execute(BytesRead{popped});
+                test.execute(Peek{expected});
+            }
+        }
+
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -45,11 +45,13 @@ void ByteStreamAction::execute(ByteStream &) const {}
 
 ByteStreamAction::~ByteStreamAction() {}
 
-ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name, const size_t capacity)
-    : _test_name(test_name), _byte_stream(capacity) {
+ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name,
+                                             const size_t capacity,
+                                             const ByteStream::Backend backend)
+    : _test_name(test_name), _byte_stream(capacity, backend) {
     std::ostringstream ss;
     ss << "Initialized with ("
-       << "capacity=" << capacity << ")";
+       << "capacity=" << capacity << (backend == ByteStream::Backend::Ring ? ", backend=Ring" : "") << ")";
     _steps_executed.emplace_back(ss.str());
 }
 
@@ -181,4 +183,17 @@ void Peek::execute(ByteStream &bs) const {
         throw ByteStreamExpectationViolation("Expected \"" + _output + "\" at the front of the stream, but found \"" +
                                              output + "\"");
     }
+    std::string viewed;
+    for (const auto &iov : bs.peek_views(_output.size()).as_iovecs()) {
+        viewed.append(static_cast<const char *>(iov.iov_base), iov.iov_len);
+    }
+    if (viewed != _output) {
+        throw ByteStreamExpectationViolation("Expected peek_views() to expose \"" + _output + "\", but found \"" +
+                                             viewed + "\"");
+    }
+    const auto sliced = bs.peek_buffers(_output.size()).concatenate();
+    if (sliced != _output) {
+        throw ByteStreamExpectationViolation("Expected peek_buffers() to expose \"" + _output + "\", but found \"" +
+                                             sliced + "\"");
+    }
 }
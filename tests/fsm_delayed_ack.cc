@@ -0,0 +1,96 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        TCPConfig cfg{};
+        cfg.delayed_ack = true;
+        const string data(MSS, 'x');
+
+        // every second in-order segment is ACKed; a lone segment is ACKed when the timer fires
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            for (unsigned int i = 0; i < 6; i++) {
+                test.send_data(rx_isn + 1 + i * MSS, tx_isn + 1, data.cbegin(), data.cend());
+                if (i % 2 == 0) {
+                    test.execute(ExpectNoSegment{}, "the first of two segments was ACKed at once");
+                } else {
+                    test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + (i + 1) * MSS),
+                                 "the second of two segments was not ACKed");
+                }
+            }
+            test.execute(ExpectAcksSuppressed{3});
+
+            test.send_data(rx_isn + 1 + 6 * MSS, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectNextTimeout{cfg.ack_delay});
+            test.execute(Tick{cfg.ack_delay - 1u});
+            test.execute(ExpectNoSegment{}, "ACK sent before the delay");
+            test.execute(ExpectNextTimeout{1});
+            test.execute(Tick{1});
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 7 * MSS), "delayed ACK never sent");
+        }
+
+        // out-of-order data, and the segment that fills the hole, are ACKed at once
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test.send_data(rx_isn + 1 + MSS, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1));
+            test.send_data(rx_isn + 1 + 2 * MSS, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1));
+            test.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 3 * MSS));
+            test.execute(ExpectAcksSuppressed{0});
+        }
+
+        // the ACK rides on outgoing data when there is some; FIN is ACKed at once
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectNoSegment{}, "ACK not delayed");
+            test.execute(Write{"reply"});
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + MSS).with_data("reply"));
+            test.execute(Tick{cfg.ack_delay});
+            test.execute(ExpectNoSegment{}, "piggybacked ACK sent again");
+            test.send_fin(rx_isn + 1 + MSS, tx_isn + 1 + 5);
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 2 + MSS), "FIN not ACKed at once");
+        }
+
+        // without delayed_ack, every segment is ACKed
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_established(TCPConfig{}, tx_isn, rx_isn);
+            for (unsigned int i = 0; i < 4; i++) {
+                test.send_data(rx_isn + 1 + i * MSS, tx_isn + 1, data.cbegin(), data.cend());
+                test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + (i + 1) * MSS));
+            }
+            test.execute(ExpectAcksSuppressed{0});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
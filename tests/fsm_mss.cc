@@ -0,0 +1,71 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // a passive side with the smaller MSS offers it on the SYN/ACK and sends no larger payloads
+        {
+            TCPConfig cfg{};
+            cfg.mss = 536;
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_listen(cfg);
+            test.execute(SendSegment{}.with_syn(true).with_seqno(rx_isn).with_win(60000).with_mss(1460));
+            TCPSegment syn_ack =
+                test.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(rx_isn + 1).with_mss(536));
+            const WrappingInt32 tx_isn = syn_ack.header().seqno;
+            test.send_ack(rx_isn + 1, tx_isn + 1, 60000);
+            test.execute(ExpectState{State::ESTABLISHED});
+
+            test.execute(Write{string(2000, 'x')});
+            for (const size_t size : {536, 536, 536, 392}) {
+                test.execute(ExpectSegment{}.with_payload_size(size).with_mss(nullopt));
+            }
+            test.execute(ExpectNoSegment{});
+        }
+
+        // an active side honors the smaller MSS offered on the SYN/ACK
+        {
+            TCPConfig cfg{};
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            cfg.fixed_isn = tx_isn;
+            TCPTestHarness test{cfg};
+            test.execute(Connect{});
+            test.execute(ExpectOneSegment{}.with_syn(true).with_seqno(tx_isn).with_mss(cfg.mss));
+            test.execute(SendSegment{}
+                             .with_syn(true)
+                             .with_ack(true)
+                             .with_seqno(rx_isn)
+                             .with_ackno(tx_isn + 1)
+                             .with_win(60000)
+                             .with_mss(536));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1));
+            test.execute(ExpectState{State::ESTABLISHED});
+
+            test.execute(Write{string(2000, 'x')});
+            for (const size_t size : {536, 536, 536, 392}) {
+                test.execute(ExpectSegment{}.with_payload_size(size));
+            }
+            test.execute(ExpectNoSegment{});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
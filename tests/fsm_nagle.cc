@@ -0,0 +1,47 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        TCPConfig cfg{};
+        cfg.nagle = true;
+
+        // TCP_NODELAY before the handshake sends nothing
+        {
+            TCPTestHarness test = TCPTestHarness::in_listen(cfg);
+            test.execute(SetNodelay{false});
+            test.execute(ExpectNoSegment{}, "set_nodelay sent a segment before the handshake");
+        }
+
+        // TCP_NODELAY on a running connection flushes what Nagle was holding
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test.execute(Write{"a"});
+            test.execute(ExpectOneSegment{}.with_seqno(tx_isn + 1).with_data("a"));
+            test.execute(Write{"b"});
+            test.execute(ExpectNoSegment{}, "second write not held back");
+            test.execute(SetNodelay{true});
+            test.execute(ExpectOneSegment{}.with_seqno(tx_isn + 2).with_data("b"), "set_nodelay did not flush");
+            test.execute(Write{"c"});
+            test.execute(ExpectOneSegment{}.with_seqno(tx_isn + 3).with_data("c"), "write held back with nodelay");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
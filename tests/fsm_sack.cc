@@ -0,0 +1,76 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        TCPConfig cfg{};
+        cfg.sack = true;
+
+        // the SYN/ACK only echoes SACK-permitted when the SYN carried it
+        for (const bool peer_sack : {true, false}) {
+            const WrappingInt32 isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_listen(cfg);
+            test.execute(SendSegment{}.with_syn(true).with_seqno(isn).with_win(1000).with_sack_permitted(peer_sack));
+            test.execute(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(isn + 1).with_sack_permitted(
+                peer_sack));
+        }
+
+        // without sack, SACK-permitted is never offered or echoed
+        {
+            TCPConfig no_sack{};
+            const WrappingInt32 isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_listen(no_sack);
+            test.execute(SendSegment{}.with_syn(true).with_seqno(isn).with_win(1000).with_sack_permitted(true));
+            test.execute(ExpectOneSegment{}.with_syn(true).with_ack(true).with_sack_permitted(false));
+        }
+
+        // once SACK-permitted was exchanged, ACKs report the out-of-order data
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPConfig c{cfg};
+            c.fixed_isn = tx_isn;
+            TCPTestHarness test{c};
+            test.execute(Connect{});
+            test.execute(ExpectOneSegment{}.with_syn(true).with_seqno(tx_isn).with_sack_permitted(true));
+            test.execute(SendSegment{}
+                             .with_syn(true)
+                             .with_ack(true)
+                             .with_seqno(rx_isn)
+                             .with_ackno(tx_isn + 1)
+                             .with_win(1000)
+                             .with_sack_permitted(true));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1).with_sack({}));
+            test.execute(ExpectState{State::ESTABLISHED});
+
+            const string data(100, 'x');
+            test.send_data(rx_isn + 1 + 100, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1).with_sack(
+                {{rx_isn + 1 + 100, rx_isn + 1 + 200}}));
+            test.send_data(rx_isn + 1 + 300, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1).with_sack(
+                {{rx_isn + 1 + 300, rx_isn + 1 + 400}, {rx_isn + 1 + 100, rx_isn + 1 + 200}}));
+            test.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 200).with_sack(
+                {{rx_isn + 1 + 300, rx_isn + 1 + 400}}));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
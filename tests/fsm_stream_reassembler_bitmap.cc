@@ -0,0 +1,92 @@
+#include "bitmap_stream_reassembler.hh"
+#include "byte_stream.hh"
+#include "stream_reassembler.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned NREPS = 64;
+static constexpr unsigned NSEGS = 256;
+static constexpr unsigned MAX_SEG_LEN = 300;
+
+// Feed the same random (overlapping, shuffled, duplicated) segments to StreamReassembler and
+// BitmapStreamReassembler, reading a little between pushes so the ring wraps, and check that
+// the two agree after every push.
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        for (unsigned rep_no = 0; rep_no < NREPS; ++rep_no) {
+            const size_t capacity = 1 + rd() % 1500;
+            StreamReassembler ref{capacity};
+            BitmapStreamReassembler bmp{capacity};
+
+            vector<tuple<size_t, size_t>> seq_size;
+            size_t offset = 0;
+            for (unsigned i = 0; i < NSEGS; ++i) {
+                const size_t size = 1 + (rd() % (MAX_SEG_LEN - 1));
+                const size_t offs = min(offset, static_cast<size_t>(rd()) % 200);
+                seq_size.emplace_back(offset - offs, size + offs);
+                if (rd() % 4 == 0) {
+                    seq_size.emplace_back(offset - offs, size + offs);  // duplicate
+                }
+                offset += size;
+            }
+            // shuffle only locally, so most segments land inside the window
+            for (size_t i = 0; i + 8 < seq_size.size(); i += 8) {
+                shuffle(seq_size.begin() + i, seq_size.begin() + i + 8, rd);
+            }
+
+            string d(offset, 0);
+            generate(d.begin(), d.end(), [&] { return rd(); });
+
+            string ref_out, bmp_out;
+            for (unsigned round = 0; round < 4 && !ref.stream_out().eof(); ++round) {
+                for (auto [off, sz] : seq_size) {
+                    const string dd = d.substr(off, sz);
+                    const bool eof = off + sz == offset;
+                    ref.push_substring(dd, off, eof);
+                    bmp.push_substring(Buffer(string(dd)), off, eof);
+
+                    if (ref.unassembled_bytes() != bmp.unassembled_bytes() ||
+                        ref.first_unassembled() != bmp.first_unassembled() ||
+                        ref.window_size() != bmp.window_size() ||
+                        ref.stream_out().input_ended() != bmp.stream_out().input_ended()) {
+                        throw runtime_error("reassembler state mismatch");
+                    }
+
+                    const size_t n = rd() % (ref.stream_out().buffer_size() + 1);
+                    ref_out += ref.stream_out().read(n);
+                    bmp_out += bmp.stream_out().read(n);
+                }
+            }
+            ref_out += ref.stream_out().read(ref.stream_out().buffer_size());
+            bmp_out += bmp.stream_out().read(bmp.stream_out().buffer_size());
+
+            if (ref_out != bmp_out) {
+                throw runtime_error("reassembled bytes differ");
+            }
+            if (bmp_out != d.substr(0, bmp_out.size())) {
+                throw runtime_error("reassembled bytes are incorrect");
+            }
+            if (ref.empty() != bmp.empty()) {
+                throw runtime_error("empty() differs");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
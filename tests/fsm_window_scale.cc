@@ -0,0 +1,117 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+static constexpr size_t CAPACITY = 1 << 20;
+static constexpr uint16_t MAX_WIN = numeric_limits<uint16_t>::max();
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        TCPConfig cfg{};
+        cfg.recv_capacity = CAPACITY;
+        cfg.send_capacity = CAPACITY;
+        cfg.window_scaling = true;
+        test_err_if(cfg.window_shift() != 5, "shift for 1 MiB: " + to_string(cfg.window_shift()));
+
+        // both sides offer window scaling: windows above 64 KiB are advertised and used
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPConfig c{cfg};
+            c.fixed_isn = tx_isn;
+            TCPTestHarness test{c};
+            test.execute(Connect{});
+            // the SYN's own window is never scaled
+            test.execute(ExpectOneSegment{}.with_syn(true).with_seqno(tx_isn).with_win(MAX_WIN).with_window_scale(5));
+            test.execute(SendSegment{}
+                             .with_syn(true)
+                             .with_ack(true)
+                             .with_seqno(rx_isn)
+                             .with_ackno(tx_isn + 1)
+                             .with_win(2000)
+                             .with_window_scale(5));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1).with_win(CAPACITY >> 5));
+            test.execute(ExpectState{State::ESTABLISHED});
+
+            // neither is the SYN/ACK's
+            test.execute(Write{string(10000, 'x')});
+            test.execute(ExpectBytesInFlight{2000});
+            for (unsigned int i = 0; i < 2; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_window_scale(nullopt));
+            }
+            test.execute(ExpectNoSegment{});
+
+            // later windows are shifted by the peer's scale
+            test.send_ack(rx_isn + 1, tx_isn + 1 + 2000, 100);
+            test.execute(ExpectBytesInFlight{100 << 5});
+            for (const size_t size : {1000, 1000, 1000, 200}) {
+                test.execute(ExpectSegment{}.with_payload_size(size));
+            }
+            test.execute(ExpectNoSegment{});
+
+            // and the window we advertise is shifted by ours
+            test.execute(SendSegment{}
+                             .with_ack(true)
+                             .with_seqno(rx_isn + 1)
+                             .with_ackno(tx_isn + 1 + 2000)
+                             .with_win(100)
+                             .with_data(string(1000, 'y')));
+            test.execute(
+                ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 1000).with_win((CAPACITY - 1000) >> 5));
+        }
+
+        // the peer does not scale: neither side does
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPConfig c{cfg};
+            c.fixed_isn = tx_isn;
+            TCPTestHarness test{c};
+            test.execute(Connect{});
+            test.execute(ExpectOneSegment{}.with_syn(true).with_window_scale(5));
+            test.execute(
+                SendSegment{}.with_syn(true).with_ack(true).with_seqno(rx_isn).with_ackno(tx_isn + 1).with_win(2000));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1).with_win(MAX_WIN));
+            test.send_ack(rx_isn + 1, tx_isn + 1, 5000);
+            test.execute(Write{string(10000, 'x')});
+            test.execute(ExpectBytesInFlight{5000});
+        }
+
+        // a passive side that scales only answers a SYN that offered it
+        for (const bool peer_scales : {true, false}) {
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test = TCPTestHarness::in_listen(cfg);
+            SendSegment syn = SendSegment{}.with_syn(true).with_seqno(rx_isn).with_win(MAX_WIN);
+            if (peer_scales) {
+                syn.with_window_scale(3);
+            }
+            test.execute(syn);
+            test.execute(ExpectOneSegment{}
+                             .with_syn(true)
+                             .with_ack(true)
+                             .with_ackno(rx_isn + 1)
+                             .with_win(MAX_WIN)
+                             .with_window_scale(peer_scales ? optional<uint8_t>{5} : nullopt));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -13,6 +13,7 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <vector>
 
 struct ReceiverTestStep {
     virtual std::string to_string() const { return "ReceiverTestStep"; }
@@ -100,6 +101,36 @@ struct ExpectUnassembledBytes : public ReceiverExpectation {
     }
 };
 
+struct ExpectSackBlocks : public ReceiverExpectation {
+    std::vector<SACKBlock> _blocks;
+    size_t _max_blocks;
+
+    ExpectSackBlocks(std::vector<SACKBlock> blocks, const size_t max_blocks = TCPOptions::MAX_SACK_BLOCKS)
+        : _blocks(std::move(blocks)), _max_blocks(max_blocks) {}
+
+    static std::string blocks_string(const std::vector<SACKBlock> &blocks) {
+        std::ostringstream ss;
+        ss << "[";
+        for (const auto &block : blocks) {
+            ss << " " << block.left << "-" << block.right;
+        }
+        ss << " ]";
+        return ss.str();
+    }
+
+    std::string description() const {
+        return "SACK blocks (at most " + std::to_string(_max_blocks) + ") " + blocks_string(_blocks);
+    }
+
+    void execute(TCPReceiver &receiver) const {
+        const std::vector<SACKBlock> blocks = receiver.sack_blocks(_max_blocks);
+        if (blocks != _blocks) {
+            throw ReceiverExpectationViolation("The TCPReceiver reported SACK blocks `" + blocks_string(blocks) +
+                                               "`, but they were expected to be `" + blocks_string(_blocks) + "`");
+        }
+    }
+};
+
 struct ExpectTotalAssembledBytes : public ReceiverExpectation {
     size_t _n_bytes;
 
@@ -0,0 +1,48 @@
+#include "receiver_harness.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // The block holding the latest out-of-order segment comes first
+        {
+            WrappingInt32 isn(rd());
+            TCPReceiverTestHarness test{10000};
+            test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+            test.execute(ExpectSackBlocks{{}});
+            test.execute(SegmentArrives{}.with_seqno(isn + 1 + 1000).with_data(string(100, 'x')));
+            test.execute(SegmentArrives{}.with_seqno(isn + 1 + 3000).with_data(string(100, 'x')));
+            test.execute(ExpectSackBlocks{{{isn + 1 + 3000, isn + 1 + 3100}, {isn + 1 + 1000, isn + 1 + 1100}}});
+            test.execute(ExpectSackBlocks{{{isn + 1 + 3000, isn + 1 + 3100}}, 1});
+        }
+
+        // Touching segments merge into one block, and assembled data leaves the blocks
+        {
+            WrappingInt32 isn(rd());
+            TCPReceiverTestHarness test{10000};
+            test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+            test.execute(SegmentArrives{}.with_seqno(isn + 1 + 200).with_data(string(100, 'x')));
+            test.execute(SegmentArrives{}.with_seqno(isn + 1 + 100).with_data(string(100, 'x')));
+            test.execute(ExpectSackBlocks{{{isn + 1 + 100, isn + 1 + 300}}});
+            test.execute(SegmentArrives{}.with_seqno(isn + 1).with_data(string(100, 'x')));
+            test.execute(ExpectAckno{WrappingInt32{isn + 1 + 300}});
+            test.execute(ExpectSackBlocks{{}});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
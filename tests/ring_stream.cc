@@ -0,0 +1,125 @@
+#include "address.hh"
+#include "file_descriptor.hh"
+#include "ring_stream.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_sponge_socket.hh"
+#include "test_err_if.hh"
+#include "test_read_all.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+static string random_string(const size_t size) {
+    auto rd = get_random_generator();
+    string data(size, 0);
+    generate(data.begin(), data.end(), [&] { return rd(); });
+    return data;
+}
+
+//! Write `data` in chunks of random sizes, then shut down writing
+static void write_chunks(RingStream &stream, const string &data) {
+    auto rd = get_random_generator();
+    for (size_t offset = 0; offset < data.size();) {
+        const size_t len = min(data.size() - offset, size_t(1 + rd() % 5000));
+        stream.write(string_view(data).substr(offset, len));
+        offset += len;
+    }
+    stream.shutdown(SHUT_WR);
+}
+
+//! From a writer thread to a reader thread, through a ring much smaller than the data
+static void transfer(RingStream &from, RingStream &to) {
+    const string data = random_string(1 << 20);
+    string received;
+    thread reader([&] { received = read_all(to); });
+    write_chunks(from, data);
+    reader.join();
+    test_err_if(received != data, "data arrived corrupted");
+}
+
+static void both_directions() {
+    auto [first, second] = RingStream::make_pair(4096);
+    transfer(first, second);
+    transfer(second, first);
+}
+
+//! Writing to an end whose peer has shut down reading fails, like EPIPE
+static void closed_by_peer() {
+    auto [first, second] = RingStream::make_pair(16);
+    second.shutdown(SHUT_RD);
+    bool threw = false;
+    try {
+        first.write("hello");
+    } catch (const runtime_error &) {
+        threw = true;
+    }
+    test_err_if(not threw, "write() succeeded after the peer shut down reading");
+
+    // a nonblocking end doesn't wait for room
+    auto [third, fourth] = RingStream::make_pair(16);
+    third.set_blocking(false);
+    test_err_if(third.write(string(100, 'x')) != 16, "nonblocking write() didn't stop when the ring was full");
+    test_err_if(fourth.read(10) != string(10, 'x'), "read() returned the wrong bytes");
+    test_err_if(third.write(string(100, 'y')) != 10, "nonblocking write() didn't fill the space that was read");
+}
+
+//! Two TCPSpongeSockets over UDP on the loopback interface, exchanging data with their owners in-process
+static void tcp_over_udp() {
+    TCPConfig c_tcp;
+    c_tcp.rt_timeout = 10;  // keeps TIME_WAIT short
+    FdAdapterConfig c_server;
+    FdAdapterConfig c_client = c_server;
+
+    UDPSocket server_udp;
+    server_udp.bind(Address("127.0.0.1", 0));
+    c_server.source = server_udp.local_address();
+    c_client.destination = c_server.source;
+
+    const string message = random_string(300000);
+
+    // the owner's end is the socket itself, and it is no file descriptor
+    static_assert(not is_base_of_v<FileDescriptor, InProcessTCPOverUDPSpongeSocket>);
+    InProcessTCPOverUDPSpongeSocket server{TCPOverUDPSocketAdapter(move(server_udp))};
+    thread server_thread([&] {
+        server.listen_and_accept(c_tcp, c_server);
+        string data = read_all(server);
+        reverse(data.begin(), data.end());
+        server.write(data);
+        server.wait_until_closed();
+    });
+
+    InProcessTCPOverUDPSpongeSocket client{TCPOverUDPSocketAdapter(UDPSocket())};
+    client.connect(c_tcp, c_client);
+    write_chunks(client, message);
+    string reply = read_all(client);
+    client.wait_until_closed();
+    server_thread.join();
+
+    reverse(reply.begin(), reply.end());
+    test_err_if(reply != message, "reply over TCP doesn't match");
+}
+
+int main() {
+    try {
+        both_directions();
+        closed_by_peer();
+        tcp_over_udp();
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include "congestion_control.hh"
+#include "sender_harness.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // Reno: slow start, timeout, slow start up to ssthresh, then one MSS per cwnd acked
+        {
+            RenoCongestionControl reno{MSS};
+            test_should_be(reno.cwnd(), 10 * MSS);
+            reno.on_ack(MSS, 0, 0);
+            test_should_be(reno.cwnd(), 11 * MSS);
+            reno.on_timeout(8 * MSS);
+            test_should_be(reno.ssthresh(), 4 * MSS);
+            test_should_be(reno.cwnd(), MSS);
+            for (unsigned i = 0; i < 3; ++i) {
+                reno.on_ack(MSS, 0, 0);
+            }
+            test_should_be(reno.cwnd(), 4 * MSS);
+            reno.on_ack(3 * MSS, 0, 0);
+            test_should_be(reno.cwnd(), 4 * MSS);
+            reno.on_ack(MSS, 0, 0);
+            test_should_be(reno.cwnd(), 5 * MSS);
+            reno.on_timeout(MSS);
+            test_should_be(reno.ssthresh(), 2 * MSS);
+        }
+
+        // CUBIC: after a timeout at W_max = 1000 segments, the window climbs back towards W_max,
+        // quickly at first and slowly near it, and reaches it after about
+        // K = cbrt(W_max * (1 - beta) / C) = 9 seconds whatever the RTT
+        for (const uint64_t rtt : {50u, 100u}) {
+            CubicCongestionControl cubic{MSS};
+            while (cubic.cwnd() < 1000 * MSS) {
+                cubic.on_ack(MSS, 0, rtt);
+            }
+            cubic.on_timeout(1000 * MSS);
+            test_should_be(cubic.ssthresh(), 700 * MSS);
+            test_should_be(cubic.cwnd(), MSS);
+
+            uint64_t now = 0;
+            auto round_trip = [&] {
+                now += rtt;
+                for (size_t acked = 0, window = cubic.cwnd(); acked < window; acked += MSS) {
+                    cubic.on_ack(MSS, now, rtt);
+                }
+            };
+            while (cubic.cwnd() < cubic.ssthresh()) {
+                round_trip();
+            }
+
+            const uint64_t epoch = now;
+            size_t at_1s = 0, at_6s = 0, at_7s = 0;
+            while (now < epoch + 11000) {
+                const size_t last = cubic.cwnd();
+                round_trip();
+                test_err_if(cubic.cwnd() < last, "window shrank without loss");
+                at_1s = now <= epoch + 1000 ? cubic.cwnd() : at_1s;
+                at_6s = now <= epoch + 6000 ? cubic.cwnd() : at_6s;
+                at_7s = now <= epoch + 7000 ? cubic.cwnd() : at_7s;
+            }
+            test_err_if(at_7s >= 1000 * MSS, "passed W_max too early: " + to_string(at_7s));
+            test_err_if(at_1s - 700 * MSS <= at_7s - at_6s, "growth is not concave below W_max");
+            test_err_if(cubic.cwnd() < 1000 * MSS or cubic.cwnd() > 1100 * MSS,
+                        "cwnd 11 s after the loss: " + to_string(cubic.cwnd()));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control = CongestionControlAlgorithm::Reno;
+
+            TCPSenderTestHarness test{"The sender never has more than cwnd bytes in flight", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            // the SYN's ACK grows the window by its one sequence number
+            test.execute(ExpectCwnd{10 * MSS + 1});
+            test.execute(WriteBytes{string(50000, 'x')});
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            test.execute(ExpectSegment{}.with_payload_size(1));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{10 * MSS + 1});
+            // the two acked segments leave, and slow start adds at most one MSS per ACK
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(60000));
+            test.execute(ExpectCwnd{11 * MSS + 1});
+            for (unsigned int i = 0; i < 3; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{TCPConfig::TIMEOUT_DFLT});
+            test.execute(ExpectSegment{}.with_seqno(isn + 1 + 2 * MSS).with_payload_size(MSS));
+            test.execute(ExpectCwnd{MSS});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without congestion control only the receiver's window counts", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(50000, 'x')});
+            test.execute(ExpectCwnd{nullopt});
+            test.execute(ExpectBytesInFlight{50000});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
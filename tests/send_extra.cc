@@ -462,7 +462,8 @@ int main() {
             test.execute(AckReceived{WrappingInt32{isn + 12}}.with_win(1000));
             test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
             test.execute(Tick{5 * rto});
-            test.execute(ExpectSegment{}.with_payload_size(4).with_data("ijkl").with_seqno(isn + 8).with_fin(true));
+            //  "ijkl" 已被ack, 只需重传FIN
+            test.execute(ExpectSegment{}.with_payload_size(0).with_seqno(isn + 12).with_fin(true));
             test.execute(ExpectNoSegment{});
             test.execute(AckReceived(WrappingInt32{isn + 13}).with_win(1000));
             test.execute(AckReceived(WrappingInt32{isn + 1}).with_win(1000));
@@ -473,6 +474,34 @@ int main() {
             test.execute(ExpectNoSegment{});
             test.execute(ExpectState{TCPSenderStateSummary::FIN_ACKED});
         }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            const size_t rto = uniform_int_distribution<uint16_t>{30, 10000}(rd);
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = rto;
+
+            TCPSenderTestHarness test{"Partially acknowledged segment is trimmed before retransmission", cfg};
+
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(8));
+            test.execute(WriteBytes("abcdefgh"));
+            test.execute(ExpectSegment{}.with_payload_size(8).with_data("abcdefgh").with_seqno(isn + 1));
+            test.execute(ExpectBytesInFlight{8});
+            test.execute(AckReceived{WrappingInt32{isn + 4}}.with_win(8));
+            test.execute(ExpectBytesInFlight{5});
+            test.execute(WriteBytes("ijk"));
+            test.execute(ExpectSegment{}.with_payload_size(3).with_data("ijk").with_seqno(isn + 9));
+            test.execute(ExpectBytesInFlight{8});
+            test.execute(Tick{rto});
+            test.execute(ExpectSegment{}.with_payload_size(5).with_data("defgh").with_seqno(isn + 4));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 10}}.with_win(8));
+            test.execute(ExpectBytesInFlight{2});
+            test.execute(Tick{rto});
+            test.execute(ExpectSegment{}.with_payload_size(2).with_data("jk").with_seqno(isn + 10));
+        }
     } catch (const exception &e) {
         cerr << e.what() << endl;
         return 1;
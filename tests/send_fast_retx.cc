@@ -0,0 +1,165 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+
+            TCPSenderTestHarness test{"The third duplicate ACK retransmits without waiting for the RTO", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(4 * MSS, 'x')});
+            for (unsigned int i = 0; i < 4; i++) {
+                test.execute(ExpectSegment{}.with_seqno(isn + 1 + i * MSS).with_payload_size(MSS));
+            }
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(60000));
+            for (unsigned int i = 1; i < TCPSender::DUP_ACK_THRESHOLD; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(60000));
+                test.execute(ExpectNoSegment{});
+            }
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(60000));
+            test.execute(ExpectSegment{}.with_seqno(isn + 1 + MSS).with_payload_size(MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{true});
+            // a fast retransmit is not a timeout
+            test.execute(ExpectConsecutiveRetransmissions{0});
+            // ACKs carrying data, or advertising a new window, are not duplicates
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(60000).with_carries_data(true));
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(50000));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 4 * MSS}}.with_win(60000));
+            test.execute(ExpectFastRecovery{false});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+
+            TCPSenderTestHarness test{"ACKs that carry data or change the window never trigger a retransmission", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(4 * MSS, 'x')});
+            for (unsigned int i = 0; i < 4; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            for (unsigned int i = 0; i < 3; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000).with_carries_data(true));
+            }
+            for (const uint16_t win : {59000, 58000, 57000}) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(win));
+            }
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{false});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without fast_retransmit, duplicate ACKs are ignored", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(4 * MSS, 'x')});
+            for (unsigned int i = 0; i < 4; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            for (unsigned int i = 0; i < 5; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            }
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{false});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+            cfg.congestion_control = CongestionControlAlgorithm::Reno;
+
+            TCPSenderTestHarness test{"Reno fast recovery halves, inflates, and deflates cwnd", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(10 * MSS, 'x')});
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            test.execute(ExpectBytesInFlight{10 * MSS});
+            for (unsigned int i = 0; i < TCPSender::DUP_ACK_THRESHOLD; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            }
+            test.execute(ExpectSegment{}.with_seqno(isn + 1).with_payload_size(MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectCwnd{5 * MSS + 3 * MSS});
+            // each further duplicate ACK inflates cwnd, letting new data out once it exceeds the flight
+            test.execute(WriteBytes{string(5 * MSS, 'y')});
+            for (unsigned int i = 0; i < 2; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            }
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(ExpectCwnd{5 * MSS + 6 * MSS});
+            test.execute(ExpectSegment{}.with_seqno(isn + 1 + 10 * MSS).with_data(string(MSS, 'y')));
+            test.execute(ExpectNoSegment{});
+            // partial ACK: segments 1 and 2 arrived, segment 3 was lost too (NewReno)
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(60000));
+            test.execute(ExpectSegment{}.with_seqno(isn + 1 + 2 * MSS).with_payload_size(MSS));
+            test.execute(ExpectFastRecovery{true});
+            // the full ACK deflates cwnd to ssthresh
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 10 * MSS}}.with_win(60000));
+            test.execute(ExpectFastRecovery{false});
+            test.execute(ExpectCwnd{5 * MSS});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+            cfg.congestion_control = CongestionControlAlgorithm::Cubic;
+
+            TCPSenderTestHarness test{"A timeout during fast recovery falls back to slow start", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(8 * MSS, 'x')});
+            for (unsigned int i = 0; i < 8; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            for (unsigned int i = 0; i < TCPSender::DUP_ACK_THRESHOLD; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            }
+            test.execute(ExpectSegment{}.with_seqno(isn + 1).with_payload_size(MSS));
+            test.execute(ExpectFastRecovery{true});
+            // CUBIC reduces cwnd, not the flight, by beta = 0.7
+            test.execute(ExpectCwnd{(10 * MSS + 1) * 7 / 10 + 3 * MSS});
+            test.execute(Tick{TCPConfig::TIMEOUT_DFLT});
+            test.execute(ExpectSegment{}.with_seqno(isn + 1).with_payload_size(MSS));
+            test.execute(ExpectFastRecovery{false});
+            test.execute(ExpectCwnd{MSS});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include "sender_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // the MSS option survives serialization
+        {
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().options.mss = 1460;
+            seg.header().options.sack_permitted = true;
+            seg.header().update_doff();
+            test_err_if(seg.header().doff != 5 + 2, "doff: " + to_string(seg.header().doff));
+
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError, "parse failed");
+            test_err_if(not(parsed.header() == seg.header()), "options changed by serialization");
+            test_err_if(parsed.header().options.mss != 1460, "MSS lost");
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.mss = 1460;
+
+            TCPSenderTestHarness test{"Payloads are sized by the configured MSS", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn).with_mss(1460));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(ExpectMSS{1460});
+            test.execute(WriteBytes{string(10 * 1460, 'x')});
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1460).with_mss(nullopt));
+            }
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.mss = 1460;
+
+            TCPSenderTestHarness test{"A smaller MSS from the peer wins", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn).with_mss(1460));
+            test.execute(SetPeerMSS{536});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(ExpectMSS{536});
+            test.execute(WriteBytes{string(4000, 'x')});
+            for (unsigned int i = 0; i < 7; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(536));
+            }
+            test.execute(ExpectSegment{}.with_payload_size(4000 - 7 * 536));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"A larger MSS from the peer doesn't", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn).with_mss(cfg.mss));
+            test.execute(SetPeerMSS{9000});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(ExpectMSS{cfg.mss});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"An absurdly small MSS from the peer is clamped", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(SetPeerMSS{1});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(ExpectMSS{TCPConfig::MIN_MSS});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"The MSS can't change once data has been sent", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(cfg.mss, 'x')});
+            test.execute(ExpectSegment{}.with_payload_size(cfg.mss));
+            test.execute(SetPeerMSS{100});
+            test.execute(ExpectMSS{cfg.mss});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.nagle = true;
+
+            TCPSenderTestHarness test{"Small writes are coalesced while data is outstanding", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            // nothing is in flight, so the first small write goes out at once
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a"));
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(WriteBytes{"bcdefgh"});
+                test.execute(ExpectNoSegment{});
+            }
+            // the ACK releases them as one segment
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(60000));
+            test.execute(ExpectSegment{}.with_seqno(isn + 2).with_payload_size(70));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.nagle = true;
+
+            TCPSenderTestHarness test{"Full segments go out at once; only the sub-MSS tail waits", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(WriteBytes{string(2 * MSS + 10, 'x')});
+            test.execute(ExpectSegment{}.with_payload_size(MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.nagle = true;
+
+            TCPSenderTestHarness test{"FIN is not held back", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(WriteBytes{"bc"}.with_end_input(true));
+            test.execute(ExpectSegment{}.with_fin(true).with_data("bc"));
+            test.execute(ExpectSeqno{isn + 1 + 3 + 1});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without Nagle every write goes out at once", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(WriteBytes{"a"});
+                test.execute(ExpectSegment{}.with_data("a"));
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.rtt_estimation = true;
+
+            TCPSenderTestHarness test{"RTT samples set SRTT and RTO", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(ExpectRTO{1000}.with_srtt(0));
+            // first sample: SRTT = R, RTTVAR = R/2, RTO = SRTT + 4 * RTTVAR
+            test.execute(Tick{100});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            test.execute(ExpectRTO{300}.with_srtt(100));
+            // second sample of 100 ms: RTTVAR = 3/4 * 50, SRTT stays 100
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            test.execute(Tick{100});
+            test.execute(AckReceived{WrappingInt32{isn + 4}}.with_win(1000));
+            test.execute(ExpectRTO{100 + 4 * 37}.with_srtt(100));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.rtt_estimation = true;
+
+            TCPSenderTestHarness test{"Retransmitted segments are not sampled, but their ACK resets the backoff", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(Tick{100});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            test.execute(ExpectRTO{300}.with_srtt(100));
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            test.execute(Tick{299});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            test.execute(ExpectRTO{600});
+            test.execute(Tick{1000});
+            test.execute(AckReceived{WrappingInt32{isn + 4}}.with_win(1000));
+            test.execute(ExpectRTO{300}.with_srtt(100));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.rtt_estimation = true;
+            cfg.rt_timeout_max = 5000;
+
+            TCPSenderTestHarness test{"Backoff is clamped to rt_timeout_max", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(Tick{100});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            for (const uint64_t rto : {300, 600, 1200, 2400, 4800}) {
+                test.execute(ExpectRTO{rto});
+                test.execute(Tick{rto});
+                test.execute(ExpectSegment{}.with_data("abc"));
+            }
+            test.execute(ExpectRTO{5000});
+            test.execute(Tick{5000});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            test.execute(ExpectRTO{5000});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.rtt_estimation = true;
+            cfg.rt_timeout_min = 200;
+
+            TCPSenderTestHarness test{"Tiny RTTs are clamped to rt_timeout_min", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(Tick{1});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            for (unsigned int i = 0; i < 16; i++) {
+                test.execute(WriteBytes{"x"});
+                test.execute(ExpectSegment{}.with_data("x"));
+                test.execute(Tick{1});
+                test.execute(AckReceived{WrappingInt32{isn + 2 + i}}.with_win(1000));
+            }
+            test.execute(ExpectRTO{200}.with_srtt(1));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+
+            TCPSenderTestHarness test{"Without rtt_estimation the RTO stays rt_timeout", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(Tick{100});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            test.execute(ExpectRTO{1000}.with_srtt(0));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include "parser.hh"
+#include "sender_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // options survive serialization; unknown options are skipped
+        {
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().options.sack_permitted = true;
+            seg.header().options.sack = {{WrappingInt32(rd()), WrappingInt32(rd())},
+                                         {WrappingInt32{7}, WrappingInt32{9}}};
+            seg.header().update_doff();
+            test_err_if(seg.header().doff != 5 + 1 + 5, "doff: " + to_string(seg.header().doff));
+
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError, "parse failed");
+            test_err_if(not(parsed.header() == seg.header()), "options changed by serialization");
+
+            TCPHeader raw_header;
+            raw_header.doff = 5 + 3;
+            string raw = raw_header.serialize();
+            const string options = {2, 4, 0x05, char(0xb4), 1, 1, 4, 2, 30, 4, 0, 0};
+            raw.replace(TCPHeader::LENGTH, options.size(), options);
+            NetParser p{move(raw)};
+            TCPHeader h;
+            test_err_if(h.parse(p) != ParseResult::NoError, "parse with unknown options failed");
+            test_err_if(not h.options.sack_permitted or not h.options.sack.empty(), "SACK-permitted not found");
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.sack = true;
+
+            TCPSenderTestHarness test{"The sender retransmits only the segments the scoreboard shows as lost", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn).with_sack_permitted(true));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(10 * MSS, 'x')});
+            for (unsigned int i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+
+            // segments 0 and 4 are lost
+            const auto seg = [&](const size_t k) { return isn + 1 + k * MSS; };
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(2)}}));
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(3)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(1), seg(4)}}));
+            test.execute(ExpectSegment{}.with_seqno(seg(0)).with_payload_size(MSS));
+            test.execute(ExpectNoSegment{});
+
+            // a hole is lost once DUP_ACK_THRESHOLD segments above it were SACKed
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(5), seg(6)}, {seg(1), seg(4)}}));
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(5), seg(7)}, {seg(1), seg(4)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(5), seg(8)}, {seg(1), seg(4)}}));
+            test.execute(ExpectSegment{}.with_seqno(seg(4)).with_payload_size(MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesSacked{6 * MSS});
+            test.execute(AckReceived{seg(0)}.with_win(60000).with_sack({{seg(5), seg(9)}, {seg(1), seg(4)}}));
+            test.execute(ExpectNoSegment{});
+
+            // the retransmitted segment 0 arrives: a partial ACK, but segment 4 was already repaired
+            test.execute(AckReceived{seg(4)}.with_win(60000).with_sack({{seg(5), seg(10)}}));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{true});
+            test.execute(ExpectBytesSacked{5 * MSS});
+
+            test.execute(AckReceived{seg(10)}.with_win(60000));
+            test.execute(ExpectFastRecovery{false});
+            test.execute(ExpectBytesSacked{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without sack the SYN carries no SACK-permitted", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn).with_sack_permitted(false));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
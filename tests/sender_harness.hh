@@ -15,6 +15,7 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <vector>
 
 const unsigned int DEFAULT_TEST_WINDOW = 137;
 
@@ -99,6 +100,118 @@ struct ExpectBytesInFlight : public SenderExpectation {
     }
 };
 
+struct ExpectRTO : public SenderExpectation {
+    uint64_t _rto;
+    std::optional<uint64_t> _srtt{};
+
+    ExpectRTO(uint64_t rto) : _rto(rto) {}
+    std::string description() const {
+        std::ostringstream ss;
+        ss << "RTO " << _rto << " ms";
+        if (_srtt.has_value()) {
+            ss << ", SRTT " << _srtt.value() << " ms";
+        }
+        return ss.str();
+    }
+
+    ExpectRTO &with_srtt(uint64_t srtt) {
+        _srtt = srtt;
+        return *this;
+    }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.rto() != _rto) {
+            throw SenderExpectationViolation("The TCPSender reported an RTO of " + std::to_string(sender.rto()) +
+                                             " ms, but it was expected to be " + std::to_string(_rto) + " ms");
+        }
+        if (_srtt.has_value() and sender.srtt() != _srtt.value()) {
+            throw SenderExpectationViolation("The TCPSender reported an SRTT of " + std::to_string(sender.srtt()) +
+                                             " ms, but it was expected to be " + std::to_string(_srtt.value()) +
+                                             " ms");
+        }
+    }
+};
+
+struct ExpectCwnd : public SenderExpectation {
+    std::optional<size_t> _cwnd;
+
+    //! \param cwnd the congestion window, or `std::nullopt` for a sender without congestion control
+    ExpectCwnd(std::optional<size_t> cwnd) : _cwnd(cwnd) {}
+    std::string description() const {
+        return _cwnd.has_value() ? "cwnd " + std::to_string(_cwnd.value()) : "no congestion window";
+    }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.cwnd() != _cwnd) {
+            throw SenderExpectationViolation("The TCPSender reported a congestion window of " +
+                                             to_string(sender.cwnd()) + ", but it was expected to be " +
+                                             to_string(_cwnd));
+        }
+    }
+};
+
+struct ExpectFastRecovery : public SenderExpectation {
+    bool _in_fast_recovery;
+
+    ExpectFastRecovery(bool in_fast_recovery) : _in_fast_recovery(in_fast_recovery) {}
+    std::string description() const { return _in_fast_recovery ? "in fast recovery" : "not in fast recovery"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.in_fast_recovery() != _in_fast_recovery) {
+            throw SenderExpectationViolation(std::string("The TCPSender was ") +
+                                             (sender.in_fast_recovery() ? "" : "not ") +
+                                             "in fast recovery, but it was expected " +
+                                             (_in_fast_recovery ? "" : "not ") + "to be");
+        }
+    }
+};
+
+struct ExpectConsecutiveRetransmissions : public SenderExpectation {
+    unsigned int _n;
+
+    ExpectConsecutiveRetransmissions(unsigned int n) : _n(n) {}
+    std::string description() const { return std::to_string(_n) + " consecutive retransmissions"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.consecutive_retransmissions() != _n) {
+            throw SenderExpectationViolation("The TCPSender reported " +
+                                             std::to_string(sender.consecutive_retransmissions()) +
+                                             " consecutive retransmissions, but there were expected to be " +
+                                             std::to_string(_n));
+        }
+    }
+};
+
+struct ExpectBytesSacked : public SenderExpectation {
+    size_t _n_bytes;
+
+    ExpectBytesSacked(size_t n_bytes) : _n_bytes(n_bytes) {}
+    std::string description() const { return std::to_string(_n_bytes) + " bytes SACKed"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.bytes_sacked() != _n_bytes) {
+            std::ostringstream ss;
+            ss << "The TCPSender's scoreboard held " << sender.bytes_sacked()
+               << " SACKed bytes, but there were expected to be " << _n_bytes;
+            throw SenderExpectationViolation(ss.str());
+        }
+    }
+};
+
+struct ExpectMSS : public SenderExpectation {
+    size_t _mss;
+
+    ExpectMSS(size_t mss) : _mss(mss) {}
+    std::string description() const { return "MSS " + std::to_string(_mss); }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.mss() != _mss) {
+            throw SenderExpectationViolation("The TCPSender reported an MSS of " + std::to_string(sender.mss()) +
+                                             ", but it was expected to be " + std::to_string(_mss));
+        }
+    }
+};
+
 struct ExpectNoSegment : public SenderExpectation {
     ExpectNoSegment() {}
     std::string description() const { return "no (more) segments"; }
@@ -193,11 +306,19 @@ struct Tick : public SenderAction {
 struct AckReceived : public SenderAction {
     WrappingInt32 _ackno;
     std::optional<uint16_t> _window_advertisement{};
+    bool _carries_data = false;
+    std::vector<SACKBlock> _sack{};
 
     AckReceived(WrappingInt32 ackno) : _ackno(ackno) {}
     std::string description() const {
         std::ostringstream ss;
         ss << "ack " << _ackno.raw_value() << " winsize " << _window_advertisement.value_or(DEFAULT_TEST_WINDOW);
+        for (const auto &block : _sack) {
+            ss << " sack " << block.left << "-" << block.right;
+        }
+        if (_carries_data) {
+            ss << " on a segment carrying data";
+        }
         return ss.str();
     }
 
@@ -206,12 +327,32 @@ struct AckReceived : public SenderAction {
         return *this;
     }
 
+    //! The ACK arrives on a segment that occupies sequence numbers, so it is never a duplicate ACK
+    AckReceived &with_carries_data(bool carries_data) {
+        _carries_data = carries_data;
+        return *this;
+    }
+
+    AckReceived &with_sack(std::vector<SACKBlock> sack) {
+        _sack = std::move(sack);
+        return *this;
+    }
+
     void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
-        sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW));
+        sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW), _carries_data, _sack);
         sender.fill_window();
     }
 };
 
+struct SetPeerMSS : public SenderAction {
+    uint16_t _peer_mss;
+
+    SetPeerMSS(uint16_t peer_mss) : _peer_mss(peer_mss) {}
+    std::string description() const { return "peer's SYN offers MSS " + std::to_string(_peer_mss); }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const { sender.set_peer_mss(_peer_mss); }
+};
+
 struct Close : public SenderAction {
     Close() {}
     std::string description() const { return "close"; }
@@ -232,6 +373,8 @@ struct ExpectSegment : public SenderExpectation {
     std::optional<uint16_t> win{};
     std::optional<size_t> payload_size{};
     std::optional<std::string> data{};
+    std::optional<bool> sack_permitted{};
+    std::optional<std::optional<uint16_t>> mss{};
 
     ExpectSegment &with_ack(bool ack_) {
         ack = ack_;
@@ -290,6 +433,17 @@ struct ExpectSegment : public SenderExpectation {
         return *this;
     }
 
+    ExpectSegment &with_sack_permitted(bool sack_permitted_) {
+        sack_permitted = sack_permitted_;
+        return *this;
+    }
+
+    //! \param mss_ the expected MSS option, or `std::nullopt` for none
+    ExpectSegment &with_mss(std::optional<uint16_t> mss_) {
+        mss = mss_;
+        return *this;
+    }
+
     std::string segment_description() const {
         std::ostringstream o;
         o << "(";
@@ -317,6 +471,12 @@ struct ExpectSegment : public SenderExpectation {
         if (payload_size.has_value()) {
             o << "payload_size=" << payload_size.value() << ",";
         }
+        if (sack_permitted.has_value()) {
+            o << "sack_permitted=" << sack_permitted.value() << ",";
+        }
+        if (mss.has_value()) {
+            o << "mss=" << to_string(mss.value()) << ",";
+        }
         if (data.has_value()) {
             o << "\"";
             for (unsigned int i = 0; i < std::min(size_t(16), data.value().size()); i++) {
@@ -339,7 +499,7 @@ struct ExpectSegment : public SenderExpectation {
     virtual std::string description() const { return "segment sent with " + segment_description(); }
 
     //  check queue队头的tcpsegment是否等于ExpectSegment类内预期的tcp segment
-    void execute(TCPSender &, std::queue<TCPSegment> &segments) const {
+    void execute(TCPSender &sender, std::queue<TCPSegment> &segments) const {
         if (segments.empty()) {
             throw SegmentExpectationViolation::violated_verb("existed");
         }
@@ -366,12 +526,20 @@ struct ExpectSegment : public SenderExpectation {
         if (win.has_value() and seg.header().win != win.value()) {
             throw SegmentExpectationViolation::violated_field("win", win.value(), seg.header().win);
         }
+        if (sack_permitted.has_value() and seg.header().options.sack_permitted != sack_permitted.value()) {
+            throw SegmentExpectationViolation::violated_field(
+                "sack_permitted", sack_permitted.value(), seg.header().options.sack_permitted);
+        }
+        if (mss.has_value() and seg.header().options.mss != mss.value()) {
+            throw SegmentExpectationViolation::violated_field(
+                "mss", to_string(mss.value()), to_string(seg.header().options.mss));
+        }
         if (payload_size.has_value() and seg.payload().size() != payload_size.value()) {
             cout<<"payload "<<seg.payload().copy()<<endl;
             throw SegmentExpectationViolation::violated_field(
                 "payload_size", payload_size.value(), seg.payload().size());
         }
-        if (seg.payload().size() > TCPConfig::MAX_PAYLOAD_SIZE) {
+        if (seg.payload().size() > sender.mss()) {
             cout<<"payload "<<seg.payload().copy()<<endl;
             throw SegmentExpectationViolation("packet has length (" + std::to_string(seg.payload().size()) +
                                               ") greater than the maximum");
@@ -399,7 +567,7 @@ class TCPSenderTestHarness {
   public:
     TCPSenderTestHarness(const std::string &name_, TCPConfig config)
         : outbound_segments()
-        , sender(config.send_capacity, config.rt_timeout, config.fixed_isn)
+        , sender(config)
         , steps_executed()
         , name(name_) {
         sender.fill_window();
@@ -11,6 +11,8 @@
 #include <exception>
 #include <optional>
 #include <sstream>
+#include <string>
+#include <vector>
 
 struct TCPExpectation : public TCPTestStep {
     virtual ~TCPExpectation() {}
@@ -123,6 +125,10 @@ struct ExpectSegment : public TCPExpectation {
     std::optional<uint16_t> win{};
     std::optional<size_t> payload_size{};
     std::optional<std::string> data{};
+    std::optional<bool> sack_permitted{};
+    std::optional<std::vector<SACKBlock>> sack{};
+    std::optional<std::optional<uint8_t>> window_scale{};
+    std::optional<std::optional<uint16_t>> mss{};
 
     ExpectSegment &with_ack(bool ack_) {
         ack = ack_;
@@ -181,6 +187,28 @@ struct ExpectSegment : public TCPExpectation {
         return *this;
     }
 
+    ExpectSegment &with_sack_permitted(bool sack_permitted_) {
+        sack_permitted = sack_permitted_;
+        return *this;
+    }
+
+    ExpectSegment &with_sack(std::vector<SACKBlock> sack_) {
+        sack = std::move(sack_);
+        return *this;
+    }
+
+    //! \param window_scale_ the expected window scale shift, or `std::nullopt` for no window scale option
+    ExpectSegment &with_window_scale(std::optional<uint8_t> window_scale_) {
+        window_scale = window_scale_;
+        return *this;
+    }
+
+    //! \param mss_ the expected MSS option, or `std::nullopt` for none
+    ExpectSegment &with_mss(std::optional<uint16_t> mss_) {
+        mss = mss_;
+        return *this;
+    }
+
     std::string segment_description() const {
         std::ostringstream o;
         o << "(";
@@ -208,6 +236,18 @@ struct ExpectSegment : public TCPExpectation {
         if (payload_size.has_value()) {
             o << "payload_size=" << payload_size.value() << ",";
         }
+        if (sack_permitted.has_value()) {
+            o << "sack_permitted=" << sack_permitted.value() << ",";
+        }
+        if (sack.has_value()) {
+            o << "sack=" << sack_string(sack.value()) << ",";
+        }
+        if (window_scale.has_value()) {
+            o << "window_scale=" << option_string(window_scale.value()) << ",";
+        }
+        if (mss.has_value()) {
+            o << "mss=" << option_string(mss.value()) << ",";
+        }
         if (data.has_value()) {
             o << "data=";
             append_data(o, data.value());
@@ -217,6 +257,21 @@ struct ExpectSegment : public TCPExpectation {
         return o.str();
     }
 
+    static std::string sack_string(const std::vector<SACKBlock> &blocks) {
+        std::ostringstream o;
+        o << "[";
+        for (const auto &block : blocks) {
+            o << " " << block.left << "-" << block.right;
+        }
+        o << " ]";
+        return o.str();
+    }
+
+    template <typename T>
+    static std::string option_string(const std::optional<T> &option) {
+        return option.has_value() ? std::to_string(option.value()) : "none";
+    }
+
     virtual std::string description() const { return "segment sent with " + segment_description(); }
 
     virtual TCPSegment expect_seg(TCPTestHarness &harness) const {
@@ -258,6 +313,23 @@ struct ExpectSegment : public TCPExpectation {
             throw SegmentExpectationViolation::violated_field(
                 "payload_size", payload_size.value(), seg.payload().size());
         }
+        if (sack_permitted.has_value() and seg.header().options.sack_permitted != sack_permitted.value()) {
+            throw SegmentExpectationViolation::violated_field(
+                "sack_permitted", sack_permitted.value(), seg.header().options.sack_permitted);
+        }
+        if (sack.has_value() and seg.header().options.sack != sack.value()) {
+            throw SegmentExpectationViolation::violated_field(
+                "sack", sack_string(sack.value()), sack_string(seg.header().options.sack));
+        }
+        if (window_scale.has_value() and seg.header().options.window_scale != window_scale.value()) {
+            throw SegmentExpectationViolation::violated_field("window_scale",
+                                                              option_string(window_scale.value()),
+                                                              option_string(seg.header().options.window_scale));
+        }
+        if (mss.has_value() and seg.header().options.mss != mss.value()) {
+            throw SegmentExpectationViolation::violated_field(
+                "mss", option_string(mss.value()), option_string(seg.header().options.mss));
+        }
         if (seg.length_in_sequence_space() > TCPConfig::MAX_PAYLOAD_SIZE) {
             throw SegmentExpectationViolation("packet has length_including_flags (" +
                                               std::to_string(seg.length_in_sequence_space()) +
@@ -389,6 +461,50 @@ struct ExpectLingerTimer : public TCPExpectation {
     }
 };
 
+struct ExpectAcksSuppressed : public TCPExpectation {
+    uint64_t acks;
+
+    ExpectAcksSuppressed(uint64_t acks_) : acks(acks_) {}
+
+    std::string description() const {
+        std::ostringstream o;
+        o << "TCP has folded " << acks << " ACKs into later segments";
+        return o.str();
+    }
+
+    void execute(TCPTestHarness &harness) const {
+        uint64_t actual_acks = harness._fsm.acks_suppressed();
+        if (actual_acks != acks) {
+            throw TCPPropertyViolation::make("acks_suppressed", acks, actual_acks);
+        }
+    }
+};
+
+struct ExpectNextTimeout : public TCPExpectation {
+    std::optional<size_t> ms;
+
+    //! \param ms_ milliseconds until the TCP next has something to do in tick(), or `std::nullopt` for nothing
+    ExpectNextTimeout(std::optional<size_t> ms_) : ms(ms_) {}
+
+    std::string description() const {
+        std::ostringstream o;
+        if (ms.has_value()) {
+            o << "TCP's next timeout is in " << ms.value() << " ms";
+        } else {
+            o << "TCP has no timeout pending";
+        }
+        return o.str();
+    }
+
+    void execute(TCPTestHarness &harness) const {
+        std::optional<size_t> actual_ms = harness._fsm.next_timeout();
+        if (actual_ms != ms) {
+            throw TCPPropertyViolation::make(
+                "next_timeout", ExpectSegment::option_string(ms), ExpectSegment::option_string(actual_ms));
+        }
+    }
+};
+
 struct SendSegment : public TCPAction {
     bool ack{false};
     bool rst{false};
@@ -399,6 +515,7 @@ struct SendSegment : public TCPAction {
     uint16_t win{0};
     size_t payload_size{0};
     std::string data{};
+    TCPOptions options{};
 
     SendSegment() {}
 
@@ -411,6 +528,7 @@ struct SendSegment : public TCPAction {
         ackno = seg.header().ackno;
         win = seg.header().win;
         data = seg.payload();
+        options = seg.header().options;
     }
 
     SendSegment &with_ack(bool ack_) {
@@ -462,6 +580,26 @@ struct SendSegment : public TCPAction {
         return *this;
     }
 
+    SendSegment &with_sack_permitted(bool sack_permitted_) {
+        options.sack_permitted = sack_permitted_;
+        return *this;
+    }
+
+    SendSegment &with_sack(std::vector<SACKBlock> sack_) {
+        options.sack = std::move(sack_);
+        return *this;
+    }
+
+    SendSegment &with_window_scale(uint8_t window_scale_) {
+        options.window_scale = window_scale_;
+        return *this;
+    }
+
+    SendSegment &with_mss(uint16_t mss_) {
+        options.mss = mss_;
+        return *this;
+    }
+
     TCPSegment get_segment() const {
         TCPSegment data_seg;
         data_seg.payload() = std::string(data);
@@ -473,6 +611,8 @@ struct SendSegment : public TCPAction {
         data_hdr.ackno = ackno;
         data_hdr.seqno = seqno;
         data_hdr.win = win;
+        data_hdr.options = options;
+        data_hdr.update_doff();
         return data_seg;
     }
 
@@ -557,6 +697,16 @@ struct Tick : public TCPAction {
     void execute(TCPTestHarness &harness) const { harness._fsm.tick(ms_since_last_tick); }
 };
 
+struct SetNodelay : public TCPAction {
+    bool nodelay;
+
+    SetNodelay(bool nodelay_) : nodelay(nodelay_) {}
+
+    std::string description() const { return nodelay ? "set TCP_NODELAY" : "clear TCP_NODELAY"; }
+
+    void execute(TCPTestHarness &harness) const { harness._fsm.set_nodelay(nodelay); }
+};
+
 struct Connect : public TCPAction {
     std::string description() const { return "connect"; }
     //  TCPSender send syn
@@ -0,0 +1,111 @@
+#include "address.hh"
+#include "eventloop.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_stack.hh"
+#include "test_backends.hh"
+#include "test_err_if.hh"
+#include "test_read_all.hh"
+#include "tun.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t CONNECTIONS = 8;
+static constexpr size_t MESSAGE_SIZE = 20000;
+static constexpr uint16_t PORT = 80;
+
+//! Two stacks back to back over a datagram socket pair: many connections at once, each echoing its data reversed
+static void back_to_back(const EventLoop::Backend backend, const size_t shards) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, static_cast<int *>(fds)));
+    TCPStack server{TunTapFD(FileDescriptor(fds[0])), Address("10.0.0.2"), {}, backend, shards};
+    TCPStack client{TunTapFD(FileDescriptor(fds[1])), Address("10.0.0.1"), {}, backend, shards};
+    server.listen(PORT);
+
+    // nobody listens on this port: the connection is reset
+    bool refused = false;
+    try {
+        client.connect(Address("10.0.0.2", PORT + 1));
+    } catch (const runtime_error &) {
+        refused = true;
+    }
+    test_err_if(not refused, "connect() to a port that isn't listening succeeded");
+
+    auto rd = get_random_generator();
+    vector<string> messages;
+    vector<LocalStreamSocket> clients;
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        string message(MESSAGE_SIZE, 0);
+        generate(message.begin(), message.end(), [&] { return rd(); });
+        messages.push_back(move(message));
+        clients.push_back(client.connect(Address("10.0.0.2", PORT)));
+    }
+    vector<LocalStreamSocket> servers;
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        servers.push_back(server.accept(PORT));
+    }
+
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        clients[i].write(messages[i]);
+        clients[i].shutdown(SHUT_WR);
+    }
+
+    set<string> received;
+    for (auto &socket : servers) {
+        string data = read_all(socket);
+        test_err_if(find(messages.begin(), messages.end(), data) == messages.end(), "server got data nobody sent");
+        received.insert(data);
+        reverse(data.begin(), data.end());
+        socket.write(data);
+        socket.close();
+    }
+    test_err_if(received.size() != CONNECTIONS, "connections' data mixed up");
+
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        string reply = read_all(clients[i]);
+        reverse(reply.begin(), reply.end());
+        test_err_if(reply != messages[i], "reply doesn't match on connection " + to_string(i));
+    }
+}
+
+//! Destroying a stack resets its open connections: the peer's owner sees the end of the stream
+static void reset_on_destruction(const EventLoop::Backend backend) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, static_cast<int *>(fds)));
+    TCPStack server{TunTapFD(FileDescriptor(fds[0])), Address("10.0.0.2"), {}, backend};
+    auto client = make_unique<TCPStack>(TunTapFD(FileDescriptor(fds[1])), Address("10.0.0.1"), TCPConfig{}, backend);
+    server.listen(PORT);
+
+    LocalStreamSocket client_end = client->connect(Address("10.0.0.2", PORT));
+    LocalStreamSocket server_end = server.accept(PORT);
+    client.reset();
+    test_err_if(not read_all(server_end).empty(), "connection not reset when its stack was destroyed");
+}
+
+int main() {
+    try {
+        for (const auto backend : available_backends()) {
+            back_to_back(backend, 1);
+            back_to_back(backend, 4);
+            reset_on_destruction(backend);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
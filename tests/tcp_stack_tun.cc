@@ -0,0 +1,83 @@
+#include "address.hh"
+#include "eventloop.hh"
+#include "socket.hh"
+#include "tcp_stack.hh"
+#include "test_backends.hh"
+#include "test_err_if.hh"
+#include "test_read_all.hh"
+#include "tun.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static constexpr const char *TUN_DEVICE = "tun144";  //!< created with `multi_queue` by tun.sh
+static constexpr const char *STACK_ADDRESS = "169.254.144.9";
+static constexpr size_t QUEUES = 4;
+static constexpr size_t CONNECTIONS = 16;
+static constexpr size_t MESSAGE_SIZE = 20000;
+static constexpr uint16_t PORT = 1234;
+
+//! The kernel's TCP connects through the queues of a multiqueue TUN device to a stack with a thread per queue
+static void kernel_to_stack(const EventLoop::Backend backend) {
+    vector<TunTapFD> queues;
+    for (auto &queue : TunFD::open_queues(TUN_DEVICE, QUEUES)) {
+        queues.emplace_back(move(queue));
+    }
+    TCPStack server{move(queues), Address(STACK_ADDRESS), {}, backend};
+    server.listen(PORT);
+
+    auto rd = get_random_generator();
+    vector<string> messages;
+    vector<TCPSocket> clients;
+    vector<LocalStreamSocket> servers;
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        string message(MESSAGE_SIZE, 0);
+        generate(message.begin(), message.end(), [&] { return rd(); });
+        messages.push_back(move(message));
+        clients.emplace_back();
+        clients.back().connect(Address(STACK_ADDRESS, PORT));
+        servers.push_back(server.accept(PORT));
+    }
+
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        clients[i].write(messages[i]);
+        clients[i].shutdown(SHUT_WR);
+    }
+
+    //  accept()按建立的顺序返回, 和connect()的顺序一致
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        string data = read_all(servers[i]);
+        test_err_if(data != messages[i], "server got the wrong data on connection " + to_string(i));
+        reverse(data.begin(), data.end());
+        servers[i].write(data);
+        servers[i].close();
+    }
+
+    for (size_t i = 0; i < CONNECTIONS; ++i) {
+        string reply = read_all(clients[i]);
+        reverse(reply.begin(), reply.end());
+        test_err_if(reply != messages[i], "reply doesn't match on connection " + to_string(i));
+    }
+}
+
+int main() {
+    try {
+        for (const auto backend : available_backends()) {
+            kernel_to_stack(backend);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,23 @@
+#ifndef SPONGE_TESTS_TEST_BACKENDS_HH
+#define SPONGE_TESTS_TEST_BACKENDS_HH
+
+#include "eventloop.hh"
+
+#include <exception>
+#include <vector>
+
+//! The EventLoop backends that can be created on this host (io_uring needs Linux 5.17, and may be disabled)
+static std::vector<EventLoop::Backend> available_backends() {
+    std::vector<EventLoop::Backend> backends;
+    for (const auto backend : {EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring}) {
+        try {
+            EventLoop loop{backend};
+            backends.push_back(backend);
+        } catch (const std::exception &) {
+            // not available here: skipped
+        }
+    }
+    return backends;
+}
+
+#endif  // SPONGE_TESTS_TEST_BACKENDS_HH
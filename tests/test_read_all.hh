@@ -0,0 +1,16 @@
+#ifndef SPONGE_TESTS_TEST_READ_ALL_HH
+#define SPONGE_TESTS_TEST_READ_ALL_HH
+
+#include <string>
+
+//! Read from a socket or a RingStream until the end of the stream
+template <typename StreamT>
+static std::string read_all(StreamT &stream) {
+    std::string data;
+    while (not stream.eof()) {
+        data += stream.read();
+    }
+    return data;
+}
+
+#endif  // SPONGE_TESTS_TEST_READ_ALL_HH
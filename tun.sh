@@ -7,7 +7,8 @@ show_usage () {
 
 start_tun () {
     local TUNNUM="$1" TUNDEV="tun$1"
-    ip tuntap add mode tun user "${SUDO_USER}" name "${TUNDEV}"
+    # multi_queue: each open of the device is one of its queues (see TunFD::open_queues)
+    ip tuntap add mode tun multi_queue user "${SUDO_USER}" name "${TUNDEV}"
     ip addr add "${TUN_IP_PREFIX}.${TUNNUM}.1/24" dev "${TUNDEV}"
     ip link set dev "${TUNDEV}" up
     ip route change "${TUN_IP_PREFIX}.${TUNNUM}.0/24" dev "${TUNDEV}" rto_min 10ms
@@ -22,7 +23,7 @@ stop_tun () {
     local TUNDEV="tun$1"
     iptables -t nat -D PREROUTING -s ${TUN_IP_PREFIX}.${1}.0/24 -j CONNMARK --set-mark ${1}
     iptables -t nat -D POSTROUTING -j MASQUERADE -m connmark --mark ${1}
-    ip tuntap del mode tun name "$TUNDEV"
+    ip tuntap del mode tun multi_queue name "$TUNDEV" 2>/dev/null || ip tuntap del mode tun name "$TUNDEV"
 }
 
 start_all () {
@@ -47,8 +48,9 @@ restart_all() {
 check_tun () {
     [ "$#" != 1 ] && { echo "bad params in check_tun"; exit 1; }
     local TUNDEV="tun${1}"
-    # make sure tun is healthy: device is up, ip_forward is set, and iptables is configured
+    # make sure tun is healthy: device is up with multiple queues, ip_forward is set, and iptables is configured
     ip link show ${TUNDEV} &>/dev/null || return 1
+    ip -d link show ${TUNDEV} | grep -q multi_queue || return 2
     [ "$(cat /proc/sys/net/ipv4/ip_forward)" = "1" ] || return 2
 }
 